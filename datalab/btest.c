@@ -11,7 +11,8 @@
  * around zero and tmin and tmax for integer puzzles, and zero, norm,
  * and denorm boundaries for floating point puzzles.
  * 
- * Note: not 64-bit safe. Always compile with gcc -m32 option.
+ * Note: the puzzles assume 32-bit ints, which holds for both the
+ * native 64-bit build and the gcc -m32 build (make M32=1).
  */
 #include <stdio.h>
 #include <unistd.h>
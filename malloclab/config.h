@@ -53,15 +53,26 @@
 #define UTIL_WEIGHT .60
 
 /* 
- * Alignment requirement in bytes (either 4 or 8) 
+ * Alignment requirement in bytes: 8 for the 32-bit (-m32) build,
+ * 16 for the native 64-bit build, like the x86-64 libc malloc.
  */
+#ifdef __LP64__
+#define ALIGNMENT 16
+#else
 #define ALIGNMENT 8  
+#endif
 
 /* 
  * Maximum heap size in bytes 
  */
 #define MAX_HEAP (20*(1<<20))  /* 20 MB */
 
+/*
+ * Number of memlib regions, each MAX_HEAP bytes. Region 0 is the heap
+ * of mem_sbrk(), a threaded allocator keeps one arena per region.
+ */
+#define MEM_REGIONS 8
+
 /*****************************************************************************
  * Set exactly one of these USE_xxx constants to "1" to select a timing method
  *****************************************************************************/
@@ -15,6 +15,8 @@
 #include <assert.h>
 #include <float.h>
 #include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
 
 #include "mm.h"
 #include "memlib.h"
@@ -29,9 +31,16 @@
 #define MAXLINE     1024 /* max string size */
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
+#define REPLAYS       10 /* times each thread replays its trace in -p mode */
+#define REPLAY_RUNS    3 /* -p mode reports the best of this many runs */
+#define WALK_BLOCK   520 /* -w mode: size of the blocks on the free list */
+#define WALK_GAP      80 /* -w mode: size of the allocated blocks between them */
+#define WALK_PROBE   600 /* -w mode: a request none of the free blocks can serve */
+#define WALK_PROBES  200 /* -w mode: requests timed per run */
+#define WALK_RUNS      3 /* -w mode reports the best of this many runs */
 
 /* Returns true if p is ALIGNMENT-byte aligned */
-#define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
+#define IS_ALIGNED(p)  ((((unsigned long)(p)) % ALIGNMENT) == 0)
 
 /****************************** 
  * The key compound data types 
@@ -46,9 +55,12 @@ typedef struct range_t {
 
 /* Characterizes a single trace operation (allocator request) */
 typedef struct {
-    enum {ALLOC, FREE, REALLOC} type; /* type of request */
+    enum {ALLOC, FREE, REALLOC, CALLOC, MEMALIGN} type; /* type of request */
     int index;                        /* index for free() to use later */
-    int size;                         /* byte size of alloc/realloc request */
+    int size;                         /* byte size of alloc/realloc request,
+					 of the freed block for free (0 if memalign'd) */
+    int align;                        /* alignment of a memalign request */
+    int batch;                        /* ops in the batch this op starts, 0 or 1 if none */
 } traceop_t;
 
 /* Holds the information for one trace file*/
@@ -60,6 +72,7 @@ typedef struct {
     traceop_t *ops;      /* array of requests */
     char **blocks;       /* array of ptrs returned by malloc/realloc... */
     size_t *block_sizes; /* ... and a corresponding array of payload sizes */
+    void **batch_blocks; /* blocks of the batch request being replayed */
 } trace_t;
 
 /* 
@@ -72,6 +85,13 @@ typedef struct {
     range_t *ranges;
 } speed_t;
 
+/* Holds the params and result of one replay thread in -p mode */
+typedef struct {
+    trace_t **traces;  /* traces to replay one after the other ... */
+    int num_traces;    /* ... and their number */
+    int failed;        /* set if mm_malloc or mm_realloc returned NULL */
+} replay_t;
+
 /* Summarizes the important stats for some malloc function on some trace */
 typedef struct {
     /* defined for both libc malloc and student malloc package (mm.c) */
@@ -81,6 +101,9 @@ typedef struct {
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
+    size_t peak_heap;  /* largest heap size while running the trace */
+    size_t final_heap; /* heap size at the end of the trace */
+    size_t sbrks;      /* number of mem_sbrk calls for the trace */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
@@ -89,6 +112,8 @@ typedef struct {
  * Global variables
  *******************/
 int verbose = 0;        /* global flag for verbose output */
+static int batch_mode = 0; /* batch every malloc and free (-b) */
+static int sized_mode = 0; /* free with mm_free_sized (-s) */
 static int errors = 0;  /* number of errs found when running student malloc */
 char msg[MAXLINE];      /* for whenever we need to compose an error message */
 
@@ -114,6 +139,14 @@ static void clear_ranges(range_t **ranges);
 /* These functions read, allocate, and free storage for traces */
 static trace_t *read_trace(char *tracedir, char *filename);
 static void free_trace(trace_t *trace);
+static void group_batches(trace_t *trace);
+static void size_frees(trace_t *trace);
+
+/* These functions issue the allocating request of a trace operation */
+static char *mm_alloc_op(traceop_t *op);
+static char *libc_alloc_op(traceop_t *op);
+static int mm_batch_op(trace_t *trace, int i, char **blocks);
+static void mm_free_op(traceop_t *op, char *p);
 
 /* Routines for evaluating the correctness and speed of libc malloc */
 static int eval_libc_valid(trace_t *trace, int tracenum);
@@ -124,6 +157,11 @@ static void eval_libc_speed(void *ptr);
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
 static void eval_mm_speed(void *ptr);
+static int replay_trace(trace_t *trace);
+static void *eval_mm_replay(void *ptr);
+static double run_replays(replay_t *replays, pthread_t *tids, int n);
+static void eval_mm_threads(char **tracefiles, int num_tracefiles, int max_threads);
+static void eval_mm_walk(int n);
 
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
@@ -150,6 +188,8 @@ int main(int argc, char **argv)
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    int threads = 0;     /* If set, replay traces on 1..threads threads (-p) */
+    int walk = 0;        /* If set, time walks of a free list this long (-w) */
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
@@ -158,21 +198,20 @@ int main(int argc, char **argv)
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt(argc, argv, "f:t:p:w:hvVgalbs")) != EOF) {
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
 	    break;
-        case 'f': /* Use one specific trace file only (relative to curr dir) */
-            num_tracefiles = 1;
-            if ((tracefiles = realloc(tracefiles, 2*sizeof(char *))) == NULL)
+        case 'f': /* Use specific trace files only (relative to curr dir), one per -f */
+            if ((tracefiles = realloc(tracefiles, (num_tracefiles+2)*sizeof(char *))) == NULL)
 		unix_error("ERROR: realloc failed in main");
 	    strcpy(tracedir, "./"); 
-            tracefiles[0] = strdup(optarg);
-            tracefiles[1] = NULL;
+            tracefiles[num_tracefiles++] = strdup(optarg);
+            tracefiles[num_tracefiles] = NULL;
             break;
 	case 't': /* Directory where the traces are located */
-	    if (num_tracefiles == 1) /* ignore if -f already encountered */
+	    if (num_tracefiles > 0) /* ignore if -f already encountered */
 		break;
 	    strcpy(tracedir, optarg);
 	    if (tracedir[strlen(tracedir)-1] != '/') 
@@ -181,9 +220,29 @@ int main(int argc, char **argv)
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
+        case 'p': /* Replay traces on up to <n> threads at once */
+            threads = atoi(optarg);
+            if (threads < 1) {
+                usage();
+                exit(1);
+            }
+            break;
+        case 'w': /* Time walks of a free list of <n> blocks */
+            walk = atoi(optarg);
+            if (walk < 1) {
+                usage();
+                exit(1);
+            }
+            break;
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+        case 'b': /* Batch consecutive same-size mallocs and consecutive frees */
+            batch_mode = 1;
+            break;
+        case 's': /* Free with mm_free_sized */
+            sized_mode = 1;
+            break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -238,6 +297,24 @@ int main(int argc, char **argv)
     /* Initialize the timing package */
     init_fsecs();
 
+    /* Only measure how long the search of a long free list takes */
+    if (walk) {
+	mem_init();
+	eval_mm_walk(walk);
+	exit(0);
+    }
+
+    /* Only measure how throughput scales with the number of threads */
+    if (threads) {
+#ifndef THREADED
+	fprintf(stderr, "ERROR: -p needs a thread-safe mm package, build it with make THREADED=1\n");
+	exit(1);
+#endif
+	mem_init();
+	eval_mm_threads(tracefiles, num_tracefiles, threads);
+	exit(0);
+    }
+
     /*
      * Optionally run and evaluate the libc malloc package 
      */
@@ -298,6 +375,9 @@ int main(int argc, char **argv)
 	    if (verbose > 1)
 		printf("efficiency, ");
 	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
+	    mm_stats[i].peak_heap = mem_peak_heapsize();
+	    mm_stats[i].final_heap = mem_heapsize();
+	    mm_stats[i].sbrks = mem_sbrk_count();
 	    speed_params.trace = trace;
 	    speed_params.ranges = ranges;
 	    if (verbose > 1)
@@ -309,7 +389,8 @@ int main(int argc, char **argv)
 
     /* Display the mm results in a compact table */
     if (verbose) {
-	printf("\nResults for mm malloc:\n");
+	printf("\nResults for mm malloc (%d-bit build, %d-byte alignment):\n",
+	       (int)(8 * sizeof(void *)), ALIGNMENT);
 	printresults(num_tracefiles, mm_stats);
 	printf("\n");
     }
@@ -395,9 +476,10 @@ static int add_range(range_t **ranges, char *lo, int size,
         return 0;
     }
 
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+    /* The payload must lie within the extent of the heap, or of a mapping */
+    if (((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
+	 (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) &&
+	!mem_in_mapping(lo, hi)) {
 	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
 		lo, hi, mem_heap_lo(), mem_heap_hi());
 	malloc_error(tracenum, opnum, msg);
@@ -477,7 +559,7 @@ static trace_t *read_trace(char *tracedir, char *filename)
     trace_t *trace;
     char type[MAXLINE];
     char path[MAXLINE];
-    unsigned index, size;
+    unsigned index, size, align;
     unsigned max_index = 0;
     unsigned op_index;
 
@@ -514,17 +596,40 @@ static trace_t *read_trace(char *tracedir, char *filename)
     if ((trace->block_sizes = 
 	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
 	unix_error("malloc 4 failed in read_trace");
+
+    /* ... and room for the blocks of the biggest possible batch */
+    if ((trace->batch_blocks = 
+	 (void **)malloc(trace->num_ops * sizeof(void *))) == NULL)
+	unix_error("malloc 5 failed in read_trace");
     
     /* read every request line in the trace file */
     index = 0;
     op_index = 0;
     while (fscanf(tracefile, "%s", type) != EOF) {
+	trace->ops[op_index].batch = 0;
 	switch(type[0]) {
 	case 'a':
+	case 'A': /* batched with its neighbouring A requests of the same size */
 	    fscanf(tracefile, "%u %u", &index, &size);
 	    trace->ops[op_index].type = ALLOC;
 	    trace->ops[op_index].index = index;
 	    trace->ops[op_index].size = size;
+	    trace->ops[op_index].batch = type[0] == 'A' || batch_mode;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'c':
+	    fscanf(tracefile, "%u %u", &index, &size);
+	    trace->ops[op_index].type = CALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'm':
+	    fscanf(tracefile, "%u %u %u", &index, &align, &size);
+	    trace->ops[op_index].type = MEMALIGN;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].align = align;
+	    trace->ops[op_index].size = size;
 	    max_index = (index > max_index) ? index : max_index;
 	    break;
 	case 'r':
@@ -535,9 +640,11 @@ static trace_t *read_trace(char *tracedir, char *filename)
 	    max_index = (index > max_index) ? index : max_index;
 	    break;
 	case 'f':
+	case 'F': /* batched with its neighbouring F requests */
 	    fscanf(tracefile, "%ud", &index);
 	    trace->ops[op_index].type = FREE;
 	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].batch = type[0] == 'F' || batch_mode;
 	    break;
 	default:
 	    printf("Bogus type character (%c) in tracefile %s\n", 
@@ -550,22 +657,135 @@ static trace_t *read_trace(char *tracedir, char *filename)
     fclose(tracefile);
     assert(max_index == trace->num_ids - 1);
     assert(trace->num_ops == op_index);
+    group_batches(trace);
+    size_frees(trace);
     
     return trace;
 }
 
 /*
- * free_trace - Free the trace record and the three arrays it points
+ * group_batches - Turn each run of consecutive batchable ALLOC requests
+ *     of one size, and of consecutive batchable FREE requests, into one
+ *     batch: the first request of the run gets the run's length.
+ */
+static void group_batches(trace_t *trace)
+{
+    traceop_t *ops = trace->ops;
+    int i, j;
+
+    for (i = 0; i < trace->num_ops; i = j) {
+	for (j = i + 1; ops[i].batch && j < trace->num_ops && ops[j].batch &&
+		 ops[j].type == ops[i].type &&
+		 (ops[i].type == FREE || ops[j].size == ops[i].size); j++)
+	    ops[j].batch = 0;
+	ops[i].batch = j - i;
+    }
+}
+
+/*
+ * size_frees - Give each FREE request the size of the last request
+ *     that allocated or resized its block.
+ */
+static void size_frees(trace_t *trace)
+{
+    traceop_t *ops = trace->ops;
+    int *sizes;
+    int i;
+
+    if ((sizes = (int *)calloc(trace->num_ids, sizeof(int))) == NULL)
+	unix_error("calloc in size_frees failed");
+    for (i = 0; i < trace->num_ops; i++) {
+	if (ops[i].type == FREE)
+	    ops[i].size = sizes[ops[i].index];
+	else
+	    sizes[ops[i].index] = ops[i].size;
+    }
+    free(sizes);
+}
+
+/*
+ * free_trace - Free the trace record and the four arrays it points
  *              to, all of which were allocated in read_trace().
  */
 void free_trace(trace_t *trace)
 {
-    free(trace->ops);         /* free the three arrays... */
+    free(trace->ops);         /* free the four arrays... */
     free(trace->blocks);      
     free(trace->block_sizes);
+    free(trace->batch_blocks);
     free(trace);              /* and the trace record itself... */
 }
 
+/*
+ * mm_alloc_op - Call mm_malloc, mm_calloc or mm_memalign as
+ *     directed by an ALLOC, CALLOC or MEMALIGN request.
+ */
+static char *mm_alloc_op(traceop_t *op)
+{
+    switch (op->type) {
+    case CALLOC:
+	return mm_calloc(1, op->size);
+    case MEMALIGN:
+	return mm_memalign(op->align, op->size);
+    default:
+	return mm_malloc(op->size);
+    }
+}
+
+/*
+ * mm_batch_op - Issue the batch of requests starting at request i with
+ *     one mm_malloc_batch or mm_free_batch call. The new blocks are stored
+ *     in blocks[] like those of single requests, freed blocks are left there.
+ *     Return 0 if mm_malloc_batch failed, 1 otherwise.
+ */
+static int mm_batch_op(trace_t *trace, int i, char **blocks)
+{
+    traceop_t *ops = trace->ops;
+    int k, n = ops[i].batch;
+
+    if (ops[i].type == FREE) {
+	for (k = 0; k < n; k++)
+	    trace->batch_blocks[k] = blocks[ops[i + k].index];
+	mm_free_batch(trace->batch_blocks, n);
+	return 1;
+    }
+
+    if (mm_malloc_batch(ops[i].size, n, trace->batch_blocks) != (size_t)n)
+	return 0;
+    for (k = 0; k < n; k++)
+	blocks[ops[i + k].index] = trace->batch_blocks[k];
+    return 1;
+}
+
+/*
+ * mm_free_op - Free the block p of a FREE request, with mm_free_sized
+ *     in -s mode when the request knows the block size.
+ */
+static void mm_free_op(traceop_t *op, char *p)
+{
+    if (sized_mode && op->size > 0)
+	mm_free_sized(p, op->size);
+    else
+	mm_free(p);
+}
+
+/*
+ * libc_alloc_op - The libc counterpart of mm_alloc_op
+ */
+static char *libc_alloc_op(traceop_t *op)
+{
+    void *p;
+
+    switch (op->type) {
+    case CALLOC:
+	return calloc(1, op->size);
+    case MEMALIGN:
+	return posix_memalign(&p, op->align, op->size) == 0 ? p : NULL;
+    default:
+	return malloc(op->size);
+    }
+}
+
 /**********************************************************************
  * The following functions evaluate the correctness, space utilization,
  * and throughput of the libc and mm malloc packages.
@@ -577,6 +797,7 @@ void free_trace(trace_t *trace)
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) 
 {
     int i, j;
+    int batch_end = 0;
     int index;
     int size;
     int oldsize;
@@ -599,12 +820,25 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	index = trace->ops[i].index;
 	size = trace->ops[i].size;
 
+	/* The first request of a batch issues all of them, each is checked below */
+	if (trace->ops[i].batch > 1) {
+	    if (!mm_batch_op(trace, i, trace->blocks)) {
+		malloc_error(tracenum, i, "mm_malloc_batch failed.");
+		return 0;
+	    }
+	    batch_end = i + trace->ops[i].batch;
+	}
+
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
+        case CALLOC: /* mm_calloc */
+        case MEMALIGN: /* mm_memalign */
 
 	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+	    if (i < batch_end)
+		p = trace->blocks[index];
+	    else if ((p = mm_alloc_op(&trace->ops[i])) == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
@@ -616,6 +850,27 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	     */ 
 	    if (add_range(ranges, p, size, tracenum, i) == 0)
 		return 0;
+
+	    /* calloc'd blocks must be zeroed, memalign'd blocks aligned */
+	    if (trace->ops[i].type == CALLOC) {
+		for (j = 0; j < size; j++) {
+		    if (p[j] != 0) {
+			malloc_error(tracenum, i, "mm_calloc did not zero the block");
+			return 0;
+		    }
+		}
+	    }
+	    if (trace->ops[i].type == MEMALIGN &&
+		((unsigned long)p) % trace->ops[i].align != 0) {
+		sprintf(msg, "mm_memalign payload (%p) not aligned to %d bytes",
+			p, trace->ops[i].align);
+		malloc_error(tracenum, i, msg);
+		return 0;
+	    }
+	    if (mm_usable_size(p) < size) {
+		malloc_error(tracenum, i, "mm_usable_size is below the request size");
+		return 0;
+	    }
 	    
 	    /* ADDED: cgw
 	     * fill range with low byte of index.  This will be used later
@@ -644,6 +899,10 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Check new block for correctness and add it to range list */
 	    if (add_range(ranges, newp, size, tracenum, i) == 0)
 		return 0;
+	    if (mm_usable_size(newp) < size) {
+		malloc_error(tracenum, i, "mm_usable_size is below the request size");
+		return 0;
+	    }
 	    
 	    /* ADDED: cgw
 	     * Make sure that the new block contains the data from the old 
@@ -671,7 +930,8 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Remove region from list and call student's free function */
 	    p = trace->blocks[index];
 	    remove_range(ranges, p);
-	    mm_free(p);
+	    if (i >= batch_end)
+		mm_free_op(&trace->ops[i], p);
 	    break;
 
 	default:
@@ -702,6 +962,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
     int size, newsize, oldsize;
     int max_total_size = 0;
     int total_size = 0;
+    int batch_end = 0;
     char *p;
     char *newp, *oldp;
 
@@ -711,13 +972,23 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	app_error("mm_init failed in eval_mm_util");
 
     for (i = 0;  i < trace->num_ops;  i++) {
+	if (trace->ops[i].batch > 1) {
+	    if (!mm_batch_op(trace, i, trace->blocks))
+		app_error("mm_malloc_batch failed in eval_mm_util");
+	    batch_end = i + trace->ops[i].batch;
+	}
+
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_alloc */
+        case CALLOC: /* mm_calloc */
+        case MEMALIGN: /* mm_memalign */
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
+	    if (i < batch_end)
+		p = trace->blocks[index];
+	    else if ((p = mm_alloc_op(&trace->ops[i])) == NULL) 
 		app_error("mm_malloc failed in eval_mm_util");
 	    
 	    /* Remember region and size */
@@ -760,7 +1031,8 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    size = trace->block_sizes[index];
 	    p = trace->blocks[index];
 	    
-	    mm_free(p);
+	    if (i >= batch_end)
+		mm_free_op(&trace->ops[i], p);
 	    
 	    /* Keep track of current total size
 	     * of all allocated blocks */
@@ -774,7 +1046,8 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
         }
     }
 
-    return ((double)max_total_size / (double)mem_heapsize());
+    /* The heap may have shrunk by now, so compare with its peak */
+    return ((double)max_total_size / (double)mem_peak_heapsize());
 }
 
 
@@ -784,7 +1057,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
  */
 static void eval_mm_speed(void *ptr)
 {
-    int i, index, size, newsize;
+    int i, index, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
 
@@ -794,13 +1067,21 @@ static void eval_mm_speed(void *ptr)
 	app_error("mm_init failed in eval_mm_speed");
 
     /* Interpret each trace request */
-    for (i = 0;  i < trace->num_ops;  i++)
+    for (i = 0;  i < trace->num_ops;  i++) {
+	if (trace->ops[i].batch > 1) {
+	    if (!mm_batch_op(trace, i, trace->blocks))
+		app_error("mm_malloc_batch error in eval_mm_speed");
+	    i += trace->ops[i].batch - 1;
+	    continue;
+	}
+
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
+        case CALLOC: /* mm_calloc */
+        case MEMALIGN: /* mm_memalign */
             index = trace->ops[i].index;
-            size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
+            if ((p = mm_alloc_op(&trace->ops[i])) == NULL)
 		app_error("mm_malloc error in eval_mm_speed");
             trace->blocks[index] = p;
             break;
@@ -817,12 +1098,232 @@ static void eval_mm_speed(void *ptr)
         case FREE: /* mm_free */
             index = trace->ops[i].index;
             block = trace->blocks[index];
-            mm_free(block);
+            mm_free_op(&trace->ops[i], block);
             break;
 
 	default:
 	    app_error("Nonexistent request type in eval_mm_valid");
         }
+    }
+}
+
+/*
+ * replay_trace - Replay a trace REPLAYS times with a private block
+ *    array, freeing what the trace left allocated after each pass.
+ *    Return 0 if mm_malloc or mm_realloc failed, 1 otherwise.
+ */
+static int replay_trace(trace_t *trace)
+{
+    int i, k, r, index;
+    char **blocks;
+
+    if ((blocks = calloc(trace->num_ids, sizeof(char *))) == NULL)
+	unix_error("calloc in replay_trace failed");
+
+    for (r = 0; r < REPLAYS; r++) {
+	for (i = 0; i < trace->num_ops; i++) {
+	    if (trace->ops[i].batch > 1) {
+		if (!mm_batch_op(trace, i, blocks)) {
+		    free(blocks);
+		    return 0;
+		}
+		for (k = 0; k < trace->ops[i].batch && trace->ops[i].type == FREE; k++)
+		    blocks[trace->ops[i + k].index] = NULL;
+		i += trace->ops[i].batch - 1;
+		continue;
+	    }
+	    index = trace->ops[i].index;
+	    switch (trace->ops[i].type) {
+	    case ALLOC:
+	    case CALLOC:
+	    case MEMALIGN:
+		blocks[index] = mm_alloc_op(&trace->ops[i]);
+		break;
+	    case REALLOC:
+		blocks[index] = mm_realloc(blocks[index], trace->ops[i].size);
+		break;
+	    case FREE:
+		mm_free_op(&trace->ops[i], blocks[index]);
+		blocks[index] = NULL;
+		continue;
+	    }
+	    if (blocks[index] == NULL) {
+		free(blocks);
+		return 0;
+	    }
+	}
+	for (i = 0; i < trace->num_ids; i++) {
+	    if (blocks[i] != NULL)
+		mm_free(blocks[i]);
+	    blocks[i] = NULL;
+	}
+    }
+    free(blocks);
+    return 1;
+}
+
+/*
+ * eval_mm_replay - Thread body of the -p mode: replay the thread's
+ *    traces one after the other.
+ */
+static void *eval_mm_replay(void *ptr)
+{
+    replay_t *replay = (replay_t *)ptr;
+    int t;
+
+    for (t = 0; t < replay->num_traces && !replay->failed; t++)
+	replay->failed = !replay_trace(replay->traces[t]);
+    return NULL;
+}
+
+/*
+ * run_replays - Start one thread per replay on a fresh heap and wait
+ *    for all of them. Return the best elapsed wall clock time in seconds
+ *    of REPLAY_RUNS such runs.
+ */
+static double run_replays(replay_t *replays, pthread_t *tids, int n)
+{
+    struct timeval start, end;
+    double secs, best = DBL_MAX;
+    int i, run;
+
+    for (run = 0; run < REPLAY_RUNS; run++) {
+	mem_reset_brk();
+	if (mm_init() < 0)
+	    app_error("mm_init failed in run_replays");
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < n; i++)
+	    if (pthread_create(&tids[i], NULL, eval_mm_replay, &replays[i]) != 0)
+		unix_error("pthread_create in run_replays failed");
+	for (i = 0; i < n; i++)
+	    pthread_join(tids[i], NULL);
+	gettimeofday(&end, NULL);
+
+	for (i = 0; i < n; i++)
+	    if (replays[i].failed)
+		app_error("mm_malloc or mm_realloc failed in run_replays");
+	secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+	if (secs < best)
+	    best = secs;
+    }
+    return best;
+}
+
+/*
+ * eval_mm_threads - For n = 1, 2, 4, ... max_threads, replay n traces
+ *    (trace k modulo the number of traces) once on one thread, one after
+ *    the other, and once on n threads at once, and print the throughput
+ *    of both runs. Needs a thread-safe mm package.
+ */
+static void eval_mm_threads(char **tracefiles, int num_tracefiles, int max_threads)
+{
+    trace_t **traces;
+    replay_t *replays;
+    pthread_t *tids;
+    double ops, serial_secs, parallel_secs;
+    int i, n;
+
+    traces = (trace_t **)calloc(max_threads, sizeof(trace_t *));
+    replays = (replay_t *)calloc(max_threads, sizeof(replay_t));
+    tids = (pthread_t *)calloc(max_threads, sizeof(pthread_t));
+    if (traces == NULL || replays == NULL || tids == NULL)
+	unix_error("calloc in eval_mm_threads failed");
+    for (i = 0; i < max_threads; i++)
+	traces[i] = read_trace(tracedir, tracefiles[i % num_tracefiles]);
+
+    printf("\nResults for mm malloc replaying traces on threads:\n");
+    printf("%7s%10s%12s%8s%12s%8s%8s\n",
+	   "threads", "ops", "1 thr secs", "Kops", "n thr secs", "Kops", "scaling");
+    for (n = 1; ; n = (2*n < max_threads) ? 2*n : max_threads) {
+	ops = 0;
+	for (i = 0; i < n; i++)
+	    ops += (double)REPLAYS * traces[i]->num_ops;
+
+	/* One thread replays all n traces */
+	replays[0].traces = traces;
+	replays[0].num_traces = n;
+	replays[0].failed = 0;
+	serial_secs = run_replays(replays, tids, 1);
+
+	/* n threads replay one trace each */
+	for (i = 0; i < n; i++) {
+	    replays[i].traces = &traces[i];
+	    replays[i].num_traces = 1;
+	    replays[i].failed = 0;
+	}
+	parallel_secs = run_replays(replays, tids, n);
+
+	printf("%7d%10.0f%12.6f%8.0f%12.6f%8.0f%7.2fx\n", n, ops,
+	       serial_secs, (ops/1e3)/serial_secs,
+	       parallel_secs, (ops/1e3)/parallel_secs,
+	       serial_secs/parallel_secs);
+	if (n == max_threads)
+	    break;
+    }
+
+    for (i = 0; i < max_threads; i++)
+	free_trace(traces[i]);
+    free(traces);
+    free(replays);
+    free(tids);
+}
+
+/*
+ * eval_mm_walk - Free n blocks of WALK_BLOCK bytes, each between two
+ *    allocated ones so none of them coalesce, in a random order, which
+ *    gives a free list (or, for an implicit list, a heap) of n blocks
+ *    spread over far more memory than the L2 cache holds, whose links
+ *    jump back and forth. Then time WALK_PROBES
+ *    requests of WALK_PROBE bytes, each freed right away: no block on
+ *    the list serves one, so every request searches the whole list.
+ */
+static void eval_mm_walk(int n)
+{
+    struct timeval start, end;
+    double secs, best = DBL_MAX;
+    char **blocks, *tmp;
+    void *p;
+    int i, j, run;
+
+    if ((blocks = (char **)calloc(n, sizeof(char *))) == NULL)
+	unix_error("calloc in eval_mm_walk failed");
+
+    for (run = 0; run < WALK_RUNS; run++) {
+	mem_reset_brk();
+	if (mm_init() < 0)
+	    app_error("mm_init failed in eval_mm_walk");
+	for (i = 0; i < n; i++)
+	    if ((blocks[i] = mm_malloc(WALK_BLOCK)) == NULL || mm_malloc(WALK_GAP) == NULL)
+		app_error("mm_malloc failed in eval_mm_walk, try a smaller -w");
+	srand(1);
+	for (i = n - 1; i > 0; i--) {
+	    j = rand() % (i + 1);
+	    tmp = blocks[i];
+	    blocks[i] = blocks[j];
+	    blocks[j] = tmp;
+	}
+	for (i = 0; i < n; i++)
+	    mm_free(blocks[i]);
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < WALK_PROBES; i++) {
+	    if ((p = mm_malloc(WALK_PROBE)) == NULL)
+		app_error("mm_malloc failed in eval_mm_walk");
+	    mm_free(p);
+	}
+	gettimeofday(&end, NULL);
+
+	secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+	if (secs < best)
+	    best = secs;
+    }
+
+    printf("\nResults for mm malloc searching a free list:\n");
+    printf("%8s%10s%10s%12s%12s\n", "blocks", "heap KB", "requests", "secs", "ns/block");
+    printf("%8d%10zu%10d%12.6f%12.2f\n", n, mem_heapsize() / 1024, WALK_PROBES,
+	   best, best * 1e9 / ((double)WALK_PROBES * n));
+    free(blocks);
 }
 
 /*
@@ -840,7 +1341,9 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
         switch (trace->ops[i].type) {
 
         case ALLOC: /* malloc */
-	    if ((p = malloc(trace->ops[i].size)) == NULL) {
+        case CALLOC: /* calloc */
+        case MEMALIGN: /* posix_memalign */
+	    if ((p = libc_alloc_op(&trace->ops[i])) == NULL) {
 		malloc_error(tracenum, i, "libc malloc failed");
 		unix_error("System message");
 	    }
@@ -877,16 +1380,17 @@ static int eval_libc_valid(trace_t *trace, int tracenum)
 static void eval_libc_speed(void *ptr)
 {
     int i;
-    int index, size, newsize;
+    int index, newsize;
     char *p, *newp, *oldp, *block;
     trace_t *trace = ((speed_t *)ptr)->trace;
 
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
         case ALLOC: /* malloc */
+        case CALLOC: /* calloc */
+        case MEMALIGN: /* posix_memalign */
 	    index = trace->ops[i].index;
-	    size = trace->ops[i].size;
-	    if ((p = malloc(size)) == NULL)
+	    if ((p = libc_alloc_op(&trace->ops[i])) == NULL)
 		unix_error("malloc failed in eval_libc_speed");
 	    trace->blocks[index] = p;
 	    break;
@@ -926,17 +1430,22 @@ static void printresults(int n, stats_t *stats)
     double util = 0;
 
     /* Print the individual results for each trace */
-    printf("%5s%7s %5s%8s%10s%6s\n", 
-	   "trace", " valid", "util", "ops", "secs", "Kops");
+    printf("%5s%7s %5s%8s%10s%6s%9s%9s%7s\n", 
+	   "trace", " valid", "util", "ops", "secs", "Kops", "peak KB", "final KB", "sbrks");
     for (i=0; i < n; i++) {
 	if (stats[i].valid) {
-	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f", 
 		   i,
 		   "yes",
 		   stats[i].util*100.0,
 		   stats[i].ops,
 		   stats[i].secs,
 		   (stats[i].ops/1e3)/stats[i].secs);
+	    if (stats[i].peak_heap) /* mm package only */
+		printf("%9.0f%9.0f%7zu\n", stats[i].peak_heap/1024.0,
+		       stats[i].final_heap/1024.0, stats[i].sbrks);
+	    else
+		printf("%9s%9s%7s\n", "-", "-", "-");
 	    secs += stats[i].secs;
 	    ops += stats[i].ops;
 	    util += stats[i].util;
@@ -1004,14 +1513,19 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: mdriver [-hvValbs] [-f <file>] [-t <dir>] [-p <n>] [-w <n>]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
-    fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+    fprintf(stderr, "\t-b         Batch consecutive same-size mallocs and consecutive frees.\n");
+    fprintf(stderr, "\t-f <file>  Use <file> as a trace file, may be given more than once.\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-p <n>     Replay traces on up to <n> threads at once and\n");
+    fprintf(stderr, "\t           report throughput scaling (needs a THREADED=1 build).\n");
+    fprintf(stderr, "\t-s         Free with mm_free_sized, passing the request size.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
+    fprintf(stderr, "\t-w <n>     Time requests that search a free list of <n> blocks.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
 }
@@ -3,6 +3,7 @@
  *            allows us to interleave calls from the student's malloc package 
  *            with the system's malloc package in libc.
  */
+#define _GNU_SOURCE /* mremap */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -10,28 +11,60 @@
 #include <sys/mman.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "memlib.h"
 #include "config.h"
 
-/* private variables */
-static char *mem_start_brk;  /* points to first byte of heap */
-static char *mem_brk;        /* points to last byte of heap */
-static char *mem_max_addr;   /* largest legal heap address */ 
+/* private variables, one entry per region */
+static char *mem_start_brk[MEM_REGIONS];  /* points to first byte of heap */
+static char *mem_brk[MEM_REGIONS];        /* points to last byte of heap */
+static char *mem_max_addr[MEM_REGIONS];   /* largest legal heap address */ 
+static char *mem_peak_brk[MEM_REGIONS];   /* highest brk since the last reset */
+static size_t mem_sbrk_calls[MEM_REGIONS]; /* mem_sbrk calls since the last reset */
+static char *mem_fresh_brk[MEM_REGIONS];  /* highest brk ever, memory above was never handed out */
+
+/* Live mappings of mem_map(), in a list guarded by mem_map_lock */
+typedef struct mapping_t {
+    char *addr;              /* first byte of the mapping */
+    size_t size;             /* its size in bytes, a multiple of the page size */
+    struct mapping_t *next;  /* next list element */
+} mapping_t;
+
+static mapping_t *mem_mappings;   /* live mappings */
+static size_t mem_map_bytes;      /* bytes mapped now */
+static size_t mem_peak_map_bytes; /* most bytes mapped since the last reset */
+static pthread_mutex_t mem_map_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void mem_unmap_all(void);
+
+/*
+ * mem_region_alloc - allocate the storage of a region, zeroed like
+ *    fresh pages from the kernel
+ */
+static int mem_region_alloc(int region)
+{
+    if ((mem_start_brk[region] = (char *)calloc(1, MAX_HEAP)) == NULL)
+	return -1;
+
+    mem_max_addr[region] = mem_start_brk[region] + MAX_HEAP;  /* max legal heap address */
+    mem_brk[region] = mem_start_brk[region];                  /* heap is empty initially */
+    mem_peak_brk[region] = mem_brk[region];
+    mem_fresh_brk[region] = mem_brk[region];
+    return 0;
+}
 
 /* 
- * mem_init - initialize the memory system model
+ * mem_init - initialize the memory system model. Only region 0 is
+ *    allocated here, the others on their first mem_region_sbrk().
  */
 void mem_init(void)
 {
     /* allocate the storage we will use to model the available VM */
-    if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
+    if (mem_region_alloc(0) < 0) {
 	fprintf(stderr, "mem_init_vm: malloc error\n");
 	exit(1);
     }
-
-    mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
-    mem_brk = mem_start_brk;                  /* heap is empty initially */
 }
 
 /* 
@@ -39,41 +72,223 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    int i;
+
+    mem_unmap_all();
+    for (i = 0; i < MEM_REGIONS; i++) {
+	free(mem_start_brk[i]);
+	mem_start_brk[i] = NULL;
+    }
 }
 
 /*
- * mem_reset_brk - reset the simulated brk pointer to make an empty heap
+ * mem_reset_brk - reset the simulated brk pointers to make empty heaps
  */
 void mem_reset_brk()
 {
-    mem_brk = mem_start_brk;
+    int i;
+
+    mem_unmap_all();
+    mem_peak_map_bytes = 0;
+    for (i = 0; i < MEM_REGIONS; i++) {
+	mem_brk[i] = mem_peak_brk[i] = mem_start_brk[i];
+	mem_sbrk_calls[i] = 0;
+    }
 }
 
 /* 
- * mem_sbrk - simple model of the sbrk function. Extends the heap 
- *    by incr bytes and returns the start address of the new area. In
- *    this model, the heap cannot be shrunk.
+ * mem_region_sbrk - simple model of the sbrk function. Extends the heap 
+ *    of a region by incr bytes and returns the old brk, which is the start
+ *    address of the new area. A negative incr shrinks the heap, but not
+ *    below its first byte. Different regions may be extended concurrently,
+ *    one region only by one thread at a time.
  */
-void *mem_sbrk(int incr) 
+void *mem_region_sbrk(int region, int incr) 
 {
-    char *old_brk = mem_brk;
+    char *old_brk;
 
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
+    if (mem_start_brk[region] == NULL && mem_region_alloc(region) < 0) {
+	errno = ENOMEM;
+	fprintf(stderr, "ERROR: mem_sbrk failed. Could not allocate region %d...\n", region);
+	return (void *)-1;
+    }
+    old_brk = mem_brk[region];
+    mem_sbrk_calls[region]++;
+    if ((incr < 0) && (mem_brk[region] + incr < mem_start_brk[region])) {
+	errno = EINVAL;
+	fprintf(stderr, "ERROR: mem_sbrk failed. Shrinking below the heap start...\n");
+	return (void *)-1;
+    }
+    if ((mem_brk[region] + incr) > mem_max_addr[region]) {
 	errno = ENOMEM;
 	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
 	return (void *)-1;
     }
-    mem_brk += incr;
+    mem_brk[region] += incr;
+    if (mem_brk[region] > mem_peak_brk[region])
+	mem_peak_brk[region] = mem_brk[region];
+    if (mem_brk[region] > mem_fresh_brk[region])
+	mem_fresh_brk[region] = mem_brk[region];
     return (void *)old_brk;
 }
 
+/* 
+ * mem_sbrk - extend the heap (region 0) by incr bytes
+ */
+void *mem_sbrk(int incr) 
+{
+    return mem_region_sbrk(0, incr);
+}
+
+/*
+ * mem_map - map size bytes (rounded up to whole pages) of fresh, zeroed
+ *    memory outside the regions, like mmap. Returns a page aligned
+ *    address, or (void *)-1 if there is no memory. Safe to call from
+ *    several threads at once.
+ */
+void *mem_map(size_t size)
+{
+    mapping_t *m;
+    size_t pagesize = mem_pagesize();
+
+    if ((m = (mapping_t *)malloc(sizeof(mapping_t))) == NULL) {
+	errno = ENOMEM;
+	return (void *)-1;
+    }
+    m->size = (size + pagesize - 1) & ~(pagesize - 1);
+    m->addr = mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m->addr == MAP_FAILED) {
+	free(m);
+	fprintf(stderr, "ERROR: mem_map failed. Ran out of memory...\n");
+	return (void *)-1;
+    }
+
+    pthread_mutex_lock(&mem_map_lock);
+    m->next = mem_mappings;
+    mem_mappings = m;
+    mem_map_bytes += m->size;
+    if (mem_map_bytes > mem_peak_map_bytes)
+	mem_peak_map_bytes = mem_map_bytes;
+    pthread_mutex_unlock(&mem_map_lock);
+    return (void *)m->addr;
+}
+
+/*
+ * mem_unmap - give back the whole mapping starting at ptr, which
+ *    mem_map returned
+ */
+void mem_unmap(void *ptr)
+{
+    mapping_t **mp, *m;
+
+    pthread_mutex_lock(&mem_map_lock);
+    for (mp = &mem_mappings; *mp != NULL && (*mp)->addr != (char *)ptr; mp = &(*mp)->next)
+	;
+    if ((m = *mp) == NULL) {
+	pthread_mutex_unlock(&mem_map_lock);
+	fprintf(stderr, "ERROR: mem_unmap failed. %p is not a mapping...\n", ptr);
+	return;
+    }
+    *mp = m->next;
+    mem_map_bytes -= m->size;
+    pthread_mutex_unlock(&mem_map_lock);
+
+    munmap(m->addr, m->size);
+    free(m);
+}
+
+/*
+ * mem_remap - resize the mapping starting at ptr, which mem_map
+ *    returned, to size bytes (rounded up to whole pages), like mremap:
+ *    the contents stay, the pages may move to a new address. Returns
+ *    that address, or (void *)-1 if there is no memory, in which case
+ *    the mapping is left as it was.
+ */
+void *mem_remap(void *ptr, size_t size)
+{
+    mapping_t *m;
+    size_t pagesize = mem_pagesize();
+    char *addr;
+
+    size = (size + pagesize - 1) & ~(pagesize - 1);
+    pthread_mutex_lock(&mem_map_lock);
+    for (m = mem_mappings; m != NULL && m->addr != (char *)ptr; m = m->next)
+	;
+    if (m == NULL) {
+	pthread_mutex_unlock(&mem_map_lock);
+	fprintf(stderr, "ERROR: mem_remap failed. %p is not a mapping...\n", ptr);
+	return (void *)-1;
+    }
+    if ((addr = mremap(m->addr, m->size, size, MREMAP_MAYMOVE)) == MAP_FAILED) {
+	pthread_mutex_unlock(&mem_map_lock);
+	fprintf(stderr, "ERROR: mem_remap failed. Ran out of memory...\n");
+	return (void *)-1;
+    }
+    mem_map_bytes = mem_map_bytes - m->size + size;
+    if (mem_map_bytes > mem_peak_map_bytes)
+	mem_peak_map_bytes = mem_map_bytes;
+    m->addr = addr;
+    m->size = size;
+    pthread_mutex_unlock(&mem_map_lock);
+    return (void *)addr;
+}
+
+/*
+ * mem_unmap_all - give back the mappings a trace left behind
+ */
+static void mem_unmap_all(void)
+{
+    while (mem_mappings != NULL)
+	mem_unmap(mem_mappings->addr);
+}
+
+/*
+ * mem_in_mapping - return 1 if the bytes lo..hi lie in one mapping
+ */
+int mem_in_mapping(void *lo, void *hi)
+{
+    mapping_t *m;
+    int found = 0;
+
+    pthread_mutex_lock(&mem_map_lock);
+    for (m = mem_mappings; m != NULL && !found; m = m->next)
+	found = (char *)lo >= m->addr && (char *)hi < m->addr + m->size;
+    pthread_mutex_unlock(&mem_map_lock);
+    return found;
+}
+
+/*
+ * mem_region_lo - return address of the first heap byte of a region
+ */
+void *mem_region_lo(int region)
+{
+    return (void *)mem_start_brk[region];
+}
+
+/* 
+ * mem_region_hi - return address of last heap byte of a region
+ */
+void *mem_region_hi(int region)
+{
+    return (void *)(mem_brk[region] - 1);
+}
+
+/*
+ * mem_region_fresh - return the first byte of a region that mem_sbrk has
+ *    never handed out since mem_init, not even before a mem_reset_brk.
+ *    The region reads as zero from there on.
+ */
+void *mem_region_fresh(int region)
+{
+    return (void *)mem_fresh_brk[region];
+}
+
 /*
  * mem_heap_lo - return address of the first heap byte
  */
 void *mem_heap_lo()
 {
-    return (void *)mem_start_brk;
+    return mem_region_lo(0);
 }
 
 /* 
@@ -81,15 +296,58 @@ void *mem_heap_lo()
  */
 void *mem_heap_hi()
 {
-    return (void *)(mem_brk - 1);
+    return mem_region_hi(0);
 }
 
 /*
- * mem_heapsize() - returns the heap size in bytes
+ * mem_heap_fresh - return the first never handed out byte of the heap
+ */
+void *mem_heap_fresh()
+{
+    return mem_region_fresh(0);
+}
+
+/*
+ * mem_peak_heapsize() - returns the largest heap size in bytes since the
+ *    last mem_reset_brk(), summed over the peaks of all regions and of
+ *    the mappings
+ */
+size_t mem_peak_heapsize() 
+{
+    size_t size = mem_peak_map_bytes;
+    int i;
+
+    for (i = 0; i < MEM_REGIONS; i++)
+	size += (size_t)(mem_peak_brk[i] - mem_start_brk[i]);
+    return size;
+}
+
+/*
+ * mem_sbrk_count() - returns the number of mem_sbrk calls since the last
+ *    mem_reset_brk(), summed over all regions
+ */
+size_t mem_sbrk_count() 
+{
+    size_t calls = 0;
+    int i;
+
+    for (i = 0; i < MEM_REGIONS; i++)
+	calls += mem_sbrk_calls[i];
+    return calls;
+}
+
+/*
+ * mem_heapsize() - returns the heap size in bytes, summed over all regions
+ *    and the mappings
  */
 size_t mem_heapsize() 
 {
-    return (size_t)(mem_brk - mem_start_brk);
+    size_t size = mem_map_bytes;
+    int i;
+
+    for (i = 0; i < MEM_REGIONS; i++)
+	size += (size_t)(mem_brk[i] - mem_start_brk[i]);
+    return size;
 }
 
 /*
@@ -7,5 +7,20 @@ void mem_reset_brk(void);
 void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
+size_t mem_peak_heapsize(void);
+size_t mem_sbrk_count(void);
 size_t mem_pagesize(void);
 
+/* Regions 0 .. MEM_REGIONS-1, region 0 is the heap above */
+void *mem_region_sbrk(int region, int incr);
+void *mem_region_lo(int region);
+void *mem_region_hi(int region);
+void *mem_region_fresh(int region);
+void *mem_heap_fresh(void);
+
+/* Mappings outside the regions, for blocks too big for the heap */
+void *mem_map(size_t size);
+void mem_unmap(void *ptr);
+void *mem_remap(void *ptr, size_t size);
+int mem_in_mapping(void *lo, void *hi);
+
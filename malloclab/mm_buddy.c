@@ -0,0 +1,558 @@
+/*
+   mm.c - Malloc package using a binary buddy system.
+
+   Chunk details:
+    Every chunk is a power of two in size and starts at an offset from
+    the heap base that is a multiple of its size. Two chunks of size s
+    at offsets o and o ^ s are `buddies': they can only be merged with
+    each other, into the chunk of size 2s at offset o & ~s. So a chunk
+    finds its buddy with one XOR, and splitting or merging a chunk walks
+    at most one step per order, no matter how many chunks are free.
+
+    A chunk has a one word header holding its size and the A
+    (ALLOCATED) bit, there is no footer: merging only ever looks at the
+    buddy, whose header sits at the buddy's offset.
+
+        header-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-
+	    |             Size of chunk, in bytes (2^order)               |A|
+        mem-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	    |             Forward pointer to next chunk in free list        |
+	    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	    |             Back pointer to previous chunk in free list       |
+	    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	    |             Unused space (may be 0 bytes long)                .
+	    .                                                               |
+	    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+
+    The forward and back pointers are only present in free chunks.
+
+   Heap structure:
+        heap start-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-
+        |        padding (ALIGNMENT - WSIZE bytes)        |
+        heap base-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+        |                                                 .
+        .         chunks, up to the end of the heap       .
+        .                                                 |
+        +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+
+    The padding puts every header one word before an aligned address,
+    so all payloads are aligned. There is no prologue or epilogue: the
+    buddy of a chunk at the end of the heap may not exist yet, which
+    merge() checks against the heap's end.
+
+    Free chunks of each order are kept in a doubly-linked list, and a
+    bitmap marks the non-empty lists, so find_fit() takes the smallest
+    big enough chunk with one `ctz'. The heap grows by aligned power of
+    two pieces until a free chunk of the requested order exists.
+
+    mm_memalign() cannot split a chunk at an arbitrary address. A chunk
+    of size s is as aligned as the heap base plus a multiple of s, so
+    if the heap base is aligned enough it just allocates a chunk of at
+    least the alignment. Otherwise it hands out an aligned pointer
+    inside a bigger chunk and writes a tag word in front of it: the
+    distance back to the chunk's payload with the T (TAG) bit set.
+    mm_free() and friends follow the tag back to the chunk.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "mm_tags.h"
+
+/*********************************************************
+ * NOTE TO STUDENTS: Before you do anything else, please
+ * provide your team information in the following struct.
+ ********************************************************/
+team_t team = {
+    /* Team name */
+    "ateam",
+    /* First member's full name */
+    "Harry Bovik",
+    /* First member's email address */
+    "bovik@cs.cmu.edu",
+    /* Second member's full name (leave blank if none) */
+    "",
+    /* Second member's email address (leave blank if none) */
+    ""
+};
+/*
+  Debugging macros:
+*/
+#define DEBUG 0
+#define HEAP_CHECK 0
+
+#if DEBUG == 1
+# define DBG_PRINTF(...) printf(__VA_ARGS__)
+#else
+# define DBG_PRINTF(...)
+#endif
+
+#if HEAP_CHECK == 1
+#define CHECKHEAP(verbose) mm_checkheap(verbose)
+#else
+#define CHECKHEAP(verbose)
+#endif
+
+/* Basic constants, the boundary tag macros are in mm_tags.h */
+#define MINBLOCKSIZE ALIGN(WSIZE + 2 * PSIZE) /* Minimum block size: WORD(HDR) + PTR(FDP) + PTR(BKP), 16 or 32 */
+#define NUM_ORDERS 32         /* Chunk sizes are 2^order bytes, order < NUM_ORDERS */
+
+/* Given a pointer from mm_memalign(), compute the payload of the chunk holding it (see TAG bit) */
+#define GET_TAG(p)  (GET(p) & 0x2)
+#define CHUNKP(bp)  (GET_TAG(HDRP(bp)) ? (char *)(bp) - GET_SIZE(HDRP(bp)) : (char *)(bp))
+
+/* Given block ptr bp, get value of foward and back pointer of that chunk */
+#define FDP(bp)  (*(char **)(bp))
+#define BKP(bp)  (*(char **)((char *)(bp) + PSIZE))
+
+/* Given block ptr bp, set forward and back pointer's value of that block by given value*/
+#define SET_FDP(bp, fdp) (FDP(bp) = fdp)
+#define SET_BKP(bp, bkp) (BKP(bp) = bkp)
+
+/* Offset of block bp from the heap base, and the block ptr of its buddy of the given size */
+#define OFFSET(bp)           ((size_t)(HDRP(bp) - heap_base))
+#define BUDDYP(bp, size)     (heap_base + (OFFSET(bp) ^ (size)) + WSIZE)
+
+/* Index of the highest (fls) and lowest (ffs) set bit of a non-zero word */
+#define FLS(x)  (31 - __builtin_clz(x))
+#define FFS(x)  (__builtin_ctz(x))
+
+/* Order of the smallest chunk holding size bytes */
+#define ORDER(size)  ((size) <= MINBLOCKSIZE ? FLS(MINBLOCKSIZE) : FLS((unsigned int)(size) - 1) + 1)
+
+/* Global declarations */
+static char *heap_base;                 /* Offset 0 of the buddy system, one word before an aligned address */
+static char *free_lists[NUM_ORDERS];    /* Free list heads, one per order */
+static unsigned int order_bitmap;       /* bit i set <=> free list of order i is non-empty */
+
+/* Function prototypes for internal helper routines */
+static void *merge(void *bp);
+static void *extend_heap(int order);
+static void *find_fit(int order);
+static void place(void *bp, int order);
+static void insert(void *bp); /* insert a free block to free list */
+static void delete(void *bp); /* delete a free block from free list */
+static void mm_checkheap(int verbose);
+
+/*
+ * mm_init - initialize the malloc package.
+ */
+int mm_init(void)
+{
+    /* Pad the heap start so that payloads, one word past the headers, are aligned */
+    if ((heap_base = mem_sbrk(ALIGNMENT - WSIZE)) == (void *) -1)
+        return -1;
+    heap_base += ALIGNMENT - WSIZE;
+
+    /* mdriver calls mm_init() once per trace, forget the old heap */
+    memset(free_lists, 0, sizeof(free_lists));
+    order_bitmap = 0;
+    return 0;
+}
+
+/*
+ * mm_malloc - Allocate the smallest free chunk of at least the request's order,
+ *             halving it down to that order.
+ */
+void *mm_malloc(size_t size)
+{
+    DBG_PRINTF("Entering mm_malloc(%zu)\n", size);
+    CHECKHEAP(0);
+    int order;
+    char *bp;
+
+    /* Ignore spurious requests */
+    if (size == 0) {
+        return NULL;
+    }
+
+    /* The chunk holds the header and the payload */
+    order = ORDER(size + WSIZE);
+    if (order >= NUM_ORDERS - 1)
+        return NULL;
+
+    if ((bp = find_fit(order)) == NULL && (bp = extend_heap(order)) == NULL)
+        return NULL;
+    place(bp, order);
+    return bp;
+}
+
+/*
+ * mm_free - Freeing a block and merge it with its free buddies.
+ */
+void mm_free(void *bp)
+{
+    DBG_PRINTF("Entering mm_free(%p)\n", bp);
+    CHECKHEAP(0);
+    if (bp == NULL)
+        return;
+    bp = CHUNKP(bp);
+    PUT(HDRP(bp), PACK(GET_SIZE(HDRP(bp)), 0));
+    merge(bp);
+}
+
+/*
+ * mm_realloc - Keep the chunk if the request still fits, halving it while it is twice too big.
+ *              Grow in place while the chunk is a lower buddy whose upper buddy is free
+ *              (or at the end of the heap), otherwise fall back to mm_malloc, memcpy and mm_free.
+ */
+void *mm_realloc(void *ptr, size_t size)
+{
+    DBG_PRINTF("Entering mm_realloc(%p, %zu)\n", ptr, size);
+    CHECKHEAP(0);
+    size_t oldsize, bsize, asize;
+    char *buddy, *heap_end, *newptr;
+
+    if (ptr == NULL)
+        return mm_malloc(size);
+    if (size == 0) {
+        mm_free(ptr);
+        return NULL;
+    }
+
+    /* An aligned pointer inside a chunk can only move */
+    if (GET_TAG(HDRP(ptr))) {
+        oldsize = mm_usable_size(ptr);
+        if ((newptr = mm_malloc(size)) == NULL)
+            return NULL;
+        memcpy(newptr, ptr, size < oldsize ? size : oldsize);
+        mm_free(ptr);
+        return newptr;
+    }
+
+    oldsize = GET_SIZE(HDRP(ptr));
+    if (ORDER(size + WSIZE) >= NUM_ORDERS - 1)
+        return NULL;
+    asize = (size_t)1 << ORDER(size + WSIZE);
+
+    /* Shrink: give the upper halves back */
+    if (asize <= oldsize) {
+        for (bsize = oldsize; bsize > asize; ) {
+            bsize >>= 1;
+            PUT(HDRP((char *)ptr + bsize), PACK(bsize, 0));
+            merge((char *)ptr + bsize);
+        }
+        PUT(HDRP(ptr), PACK(asize, 1));
+        return ptr;
+    }
+
+    /* Grow: check that every upper buddy up to asize is free (or not there yet) first */
+    heap_end = (char *)mem_heap_hi() + 1;
+    for (bsize = oldsize; bsize < asize; bsize <<= 1) {
+        buddy = BUDDYP(ptr, bsize);
+        if (buddy < (char *)ptr)
+            break;                    /* We are an upper buddy */
+        if (HDRP(buddy) < heap_end && (GET_ALLOC(HDRP(buddy)) || GET_SIZE(HDRP(buddy)) != bsize))
+            break;                    /* Buddy is (partly) in use */
+    }
+    if (bsize >= asize) {
+        /* Get the missing end of the heap in one piece before taking any buddy, so failing changes nothing */
+        if (HDRP(ptr) + asize > heap_end && mem_sbrk(HDRP(ptr) + asize - heap_end) == (void *)-1)
+            return NULL;
+        for (bsize = oldsize; bsize < asize; bsize <<= 1) {
+            buddy = BUDDYP(ptr, bsize);
+            if (HDRP(buddy) < heap_end)
+                delete(buddy);
+        }
+        PUT(HDRP(ptr), PACK(asize, 1));
+        return ptr;
+    }
+
+    /* Move the block */
+    if ((newptr = mm_malloc(size)) == NULL)
+        return NULL;
+    memcpy(newptr, ptr, oldsize - WSIZE);
+    mm_free(ptr);
+    return newptr;
+}
+
+/*
+ * mm_calloc - Allocate a zeroed block for nmemb elements of size bytes.
+ */
+void *mm_calloc(size_t nmemb, size_t size)
+{
+    void *bp;
+
+    if (nmemb != 0 && size > SIZE_MAX / nmemb)
+        return NULL;
+    size *= nmemb;
+    if ((bp = mm_malloc(size)) != NULL)
+        memset(bp, 0, size);
+    return bp;
+}
+
+/*
+ * mm_memalign - Allocate a block whose payload is aligned to alignment, a power of two.
+ *               A chunk of at least alignment bytes if the heap base allows it,
+ *               otherwise a tagged pointer into a chunk with alignment bytes to spare.
+ */
+void *mm_memalign(size_t alignment, size_t size)
+{
+    DBG_PRINTF("Entering mm_memalign(%zu, %zu)\n", alignment, size);
+    char *bp, *abp;
+
+    if (size == 0 || (alignment & (alignment - 1)))
+        return NULL;
+    if (alignment <= ALIGNMENT)
+        return mm_malloc(size);
+
+    /* Every chunk of alignment bytes or more starts on an aligned payload */
+    if (((uintptr_t)(heap_base + WSIZE) & (alignment - 1)) == 0)
+        return mm_malloc(MAX(size, alignment - WSIZE));
+
+    if ((bp = mm_malloc(size + alignment - ALIGNMENT)) == NULL)
+        return NULL;
+    abp = (char *)(((uintptr_t)bp + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    if (abp != bp)
+        PUT(HDRP(abp), PACK(abp - bp, 2)); /* The gap is at least ALIGNMENT bytes, room for the tag */
+    return abp;
+}
+
+/*
+ * mm_posix_memalign - mm_memalign() with the POSIX interface: alignment must be a power
+ *                     of two multiple of sizeof(void *), errors are returned, not set in errno.
+ */
+int mm_posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *bp;
+
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)))
+        return EINVAL;
+    if (size == 0) {
+        *memptr = NULL;
+        return 0;
+    }
+    if ((bp = mm_memalign(alignment, size)) == NULL)
+        return ENOMEM;
+    *memptr = bp;
+    return 0;
+}
+
+/*
+ * mm_usable_size - Bytes the caller may use from bp up to the end of its chunk.
+ */
+size_t mm_usable_size(void *bp)
+{
+    char *chunk;
+
+    if (bp == NULL)
+        return 0;
+    chunk = CHUNKP(bp);
+    return GET_SIZE(HDRP(chunk)) - WSIZE - ((char *)bp - chunk);
+}
+
+/*
+ * mm_malloc_batch - Allocate n blocks of size bytes into out, one by one.
+ * Return: the number of blocks allocated, less than n if the heap is full.
+ */
+size_t mm_malloc_batch(size_t size, size_t n, void **out)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        if ((out[i] = mm_malloc(size)) == NULL)
+            break;
+    return i;
+}
+
+/*
+ * mm_free_batch - Free the n blocks of ptrs, one by one.
+ */
+void mm_free_batch(void **ptrs, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        mm_free(ptrs[i]);
+}
+
+/*
+ * mm_free_sized - The header already holds the block size, so this is mm_free().
+ */
+void mm_free_sized(void *ptr, size_t size)
+{
+    (void)size;
+    mm_free(ptr);
+}
+
+/*
+ * merge - Merge the free block bp with its buddy as long as the buddy is free and whole,
+ *         then insert the result.
+ * Return: Pointer of the merged block.
+ */
+static void *merge(void *bp)
+{
+    DBG_PRINTF("Entering merge(%p)\n", bp);
+    char *heap_end = (char *)mem_heap_hi() + 1;
+    size_t size = GET_SIZE(HDRP(bp));
+    char *buddy;
+
+    for (;;) {
+        buddy = BUDDYP(bp, size);
+        /* The upper buddy of the last chunk does not exist yet */
+        if (HDRP(buddy) >= heap_end)
+            break;
+        if (GET_ALLOC(HDRP(buddy)) || GET_SIZE(HDRP(buddy)) != size)
+            break;
+        delete(buddy);
+        if (buddy < (char *)bp)
+            bp = buddy;
+        size <<= 1;
+    }
+    PUT(HDRP(bp), PACK(size, 0));
+    insert(bp);
+    return bp;
+}
+
+/*
+ * extend_heap - Grow the heap by free power of two pieces, each aligned to its size,
+ *               until a free chunk of the given order exists.
+ * Return : that chunk's payload address.
+ */
+static void *extend_heap(int order)
+{
+    size_t end, size;
+    char *bp;
+
+    while ((bp = find_fit(order)) == NULL) {
+        /* The biggest piece that keeps the heap end aligned, at most the requested order */
+        end = (char *)mem_heap_hi() + 1 - heap_base;
+        size = end & -end;
+        if (end == 0 || size > ((size_t)1 << order))
+            size = (size_t)1 << order;
+        if ((bp = mem_sbrk(size)) == (void *)-1)
+            return NULL;
+        bp += WSIZE;
+        PUT(HDRP(bp), PACK(size, 0));
+        merge(bp);
+    }
+    return bp;
+}
+
+/* find_fit - Find the smallest free chunk of at least the given order and return it's bp */
+static void *find_fit(int order)
+{
+    DBG_PRINTF("Entering find_fit(%d), ", order);
+    unsigned int map = order_bitmap & (~0U << order);
+
+    if (!map) {
+        DBG_PRINTF("not found\n");
+        return NULL;
+    }
+    DBG_PRINTF("found %p of order %d\n", free_lists[FFS(map)], FFS(map));
+    return free_lists[FFS(map)];
+}
+
+/* place - Allocate free chunk bp, split off its upper halves down to the given order */
+static void place(void *bp, int order)
+{
+    DBG_PRINTF("Entering place(%p, %d)\n", bp, order);
+    size_t size = GET_SIZE(HDRP(bp));
+    size_t asize = (size_t)1 << order;
+
+    delete(bp);
+    while (size > asize) {
+        size >>= 1;
+        PUT(HDRP((char *)bp + size), PACK(size, 0));
+        insert((char *)bp + size);
+    }
+    PUT(HDRP(bp), PACK(asize, 1));
+}
+
+/*
+ * insert - Insert given block pointer to the head of its order's free list
+ *          and mark the list as non-empty.
+ */
+static void insert(void *bp)
+{
+    int order = FLS(GET_SIZE(HDRP(bp)));
+    char *head = free_lists[order];
+
+    DBG_PRINTF("Entering insert(%p), order %d\n", bp, order);
+    SET_FDP(bp, head);
+    SET_BKP(bp, NULL);
+    if (head != NULL)
+        SET_BKP(head, bp);
+    free_lists[order] = bp;
+    order_bitmap |= 1U << order;
+}
+
+/*
+ * delete - Remove given block pointer from its free list,
+ *          clear the bitmap bit if the list becomes empty.
+ */
+static void delete(void *bp)
+{
+    int order = FLS(GET_SIZE(HDRP(bp)));
+
+    DBG_PRINTF("Entering delete(%p), order %d\n", bp, order);
+    if (FDP(bp) != NULL)
+        SET_BKP(FDP(bp), BKP(bp));
+    if (BKP(bp) != NULL)
+        SET_FDP(BKP(bp), FDP(bp));
+    else {
+        /* bp was the list head */
+        free_lists[order] = FDP(bp);
+        if (free_lists[order] == NULL)
+            order_bitmap &= ~(1U << order);
+    }
+}
+
+static void check_freelist()
+{
+    for (int i = 0; i < NUM_ORDERS; i++) {
+        char *cur = free_lists[i];
+        if (!!(order_bitmap & (1U << i)) != (cur != NULL)) {
+            printf("Order bitmap out of sync at %d\n", i);
+            exit(1);
+        }
+        for (; cur != NULL; cur = FDP(cur)) {
+            if (GET_ALLOC(HDRP(cur))) {
+                printf("Allocated block %p in free list %d\n", cur, i);
+                exit(1);
+            }
+            if (GET_SIZE(HDRP(cur)) != (1U << i)) {
+                printf("Block %p(size: %u) in wrong free list %d\n", cur, GET_SIZE(HDRP(cur)), i);
+                exit(1);
+            }
+            if (FDP(cur) != NULL && BKP(FDP(cur)) != cur) {
+                printf("Next free block does not point to current block!\n");
+                exit(1);
+            }
+        }
+    }
+}
+
+static void mm_checkheap(int verbose)
+{
+    char *heap_end = (char *)mem_heap_hi() + 1;
+
+    check_freelist();
+
+    /* Traverse blocks, check sizes, buddy alignment and merging */
+    for (char *bp = heap_base + WSIZE; HDRP(bp) < heap_end; bp = NEXT_BLKP(bp)) {
+        size_t size = GET_SIZE(HDRP(bp));
+        if ((unsigned long)bp % ALIGNMENT) {
+            printf("Address not aligned!\n");
+            exit(1);
+        }
+        if (size < MINBLOCKSIZE || (size & (size - 1)) || OFFSET(bp) % size) {
+            printf("Block %p(size: %zu) is not an aligned power of two!\n", bp, size);
+            exit(1);
+        }
+        char *buddy = BUDDYP(bp, size);
+        if (!GET_ALLOC(HDRP(bp)) && HDRP(buddy) < heap_end
+            && !GET_ALLOC(HDRP(buddy)) && GET_SIZE(HDRP(buddy)) == size) {
+            printf("Free buddies %p and %p not merged!\n", bp, buddy);
+            exit(1);
+        }
+        if (verbose)
+            printf("%p: size %zu, alloc %u\n", bp, size, GET_ALLOC(HDRP(bp)));
+    }
+}
@@ -0,0 +1,966 @@
+/*
+   mm.c - Malloc package built from compile-time policies.
+
+   The boundary tag allocators of this lab differ in a handful of
+   decisions, so instead of one file per variant this core takes each
+   decision as a policy macro, set with -D (e.g. `make MM=mm_core.c
+   MMFLAGS="-DFIT=FIT_BEST -DCLASSES=CLASSES_SEG4"`). `make policies`
+   builds one driver per combination and runs the traces on each.
+
+    FIT      Which free block a request takes:
+             FIT_FIRST   the first block that is big enough (default)
+             FIT_NEXT    the first one from where the last search stopped
+             FIT_BEST    the smallest one
+             FIT_GOOD    the smallest of the first GOOD_FIT_K ones
+             Every search stops early at an exact fit.
+
+    ORDER    Where a free list takes a freed block:
+             ORDER_LIFO  at its head (default)
+             ORDER_ADDR  in address order: the list is a treap keyed by
+                         address, whose priorities are a hash of the
+                         address, so inserting and deleting cost
+                         O(log n) expected; each node keeps the largest
+                         size of its subtree, so the search goes
+                         straight down to the next fit in address order
+
+    FOOTERS  FOOTERS_ALL  every block has a footer (default)
+             FOOTERS_FREE only free blocks have one, the P
+                          (PREV_ALLOCATED) bit of each header tells
+                          whether the previous block is in use
+
+    CLASSES  The size class table of the free lists:
+             CLASSES_IMPLICIT  no free list, the search walks the heap,
+                               which is always in address order
+             CLASSES_ONE       one explicit list (default)
+             CLASSES_POW2      one list per power of two
+             CLASSES_SEG4      four lists per power of two
+             A search starts in the class of the request and moves on
+             to bigger classes until some block fits.
+
+    FIT_FIRST, ORDER_LIFO, FOOTERS_ALL, CLASSES_ONE is the former
+    mm_explicit.c, FIT_NEXT, FOOTERS_FREE, CLASSES_IMPLICIT the former
+    mm_implicit_no_footer.c.
+
+   Chunk details:
+
+        header-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-
+	    |             Size of chunk, in bytes                       |P|A|
+        mem-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	    |     Free chunk: forward pointer to next chunk in free list    |
+	    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	    |     Free chunk: back pointer to previous chunk in free list   |
+	    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	    |             User data or unused space                         .
+	    .                                                               |
+        footer-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-
+	    |     Free chunk or FOOTERS_ALL: same as header                 |
+	    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+
+    The links exist unless CLASSES is CLASSES_IMPLICIT. With ORDER_ADDR
+    they are the left and right child of a treap node, followed by a
+    word with the largest block size of its subtree.
+    The P bit is
+    only kept with FOOTERS_FREE. The heap starts with a padding word
+    and an allocated prologue block, and ends with an allocated
+    epilogue header of size 0. The list heads live in static storage
+    and are reset by mm_init().
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "mm_tags.h"
+
+/*********************************************************
+ * NOTE TO STUDENTS: Before you do anything else, please
+ * provide your team information in the following struct.
+ ********************************************************/
+team_t team = {
+    /* Team name */
+    "ateam",
+    /* First member's full name */
+    "Harry Bovik",
+    /* First member's email address */
+    "bovik@cs.cmu.edu",
+    /* Second member's full name (leave blank if none) */
+    "",
+    /* Second member's email address (leave blank if none) */
+    ""
+};
+/*
+  Debugging macros:
+*/
+#define DEBUG 0
+#define HEAP_CHECK 0
+
+#if DEBUG == 1
+# define DBG_PRINTF(...) printf(__VA_ARGS__)
+#else
+# define DBG_PRINTF(...)
+#endif
+
+#if HEAP_CHECK == 1
+#define CHECKHEAP(verbose) mm_checkheap(verbose)
+#else
+#define CHECKHEAP(verbose)
+#endif
+
+/*
+  Policies:
+*/
+#define FIT_FIRST 0
+#define FIT_NEXT  1
+#define FIT_BEST  2
+#define FIT_GOOD  3
+#ifndef FIT
+#define FIT FIT_FIRST
+#endif
+#ifndef GOOD_FIT_K
+#define GOOD_FIT_K 4  /* The same default as the segregated list allocator */
+#endif
+
+/* With PREFETCH 1 a search prefetches the header of the next block while it looks at the current one */
+#ifndef PREFETCH
+#define PREFETCH 0
+#endif
+#if PREFETCH == 1
+#define PREFETCH_BLK(bp) __builtin_prefetch(HDRP(bp))
+#else
+#define PREFETCH_BLK(bp) ((void)(bp))
+#endif
+
+#define ORDER_LIFO 0
+#define ORDER_ADDR 1
+#ifndef ORDER
+#define ORDER ORDER_LIFO
+#endif
+
+#define FOOTERS_ALL  0
+#define FOOTERS_FREE 1
+#ifndef FOOTERS
+#define FOOTERS FOOTERS_ALL
+#endif
+
+#define CLASSES_IMPLICIT 0
+#define CLASSES_ONE      1
+#define CLASSES_POW2     2
+#define CLASSES_SEG4     3
+#ifndef CLASSES
+#define CLASSES CLASSES_ONE
+#endif
+
+/* Basic constants, the boundary tag macros are in mm_tags.h */
+#define CHUNKSIZE  (1<<12)    /* Extend heap by this amount (bytes) */
+
+/* Bytes of an allocated block that are not payload */
+#if FOOTERS == FOOTERS_ALL
+#define OVERHEAD   DSIZE
+#else
+#define OVERHEAD   WSIZE
+#endif
+
+/* Minimum block size: WORD(HDR) + PTR(FDP) + PTR(BKP) + WORD(FTR), without the links for implicit lists */
+#if CLASSES == CLASSES_IMPLICIT
+#define MINBLOCKSIZE ALIGN(DSIZE)
+#elif ORDER == ORDER_ADDR
+#define MINBLOCKSIZE ALIGN(DSIZE + 2 * PSIZE + WSIZE) /* Treap nodes have a subtree max word too */
+#else
+#define MINBLOCKSIZE ALIGN(DSIZE + 2 * PSIZE)
+#endif
+
+/* Block size for a request of size bytes */
+#define ASIZE(size)  MAX(ALIGN((size) + OVERHEAD), MINBLOCKSIZE)
+
+/* Min value of 2 values */
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+
+/* Allocation status of the block before bp: its footer, or the P bit of our header */
+#if FOOTERS == FOOTERS_ALL
+#define PREV_ALLOC(bp)  GET_ALLOC((char *)(bp) - DSIZE)
+#else
+#define PREV_ALLOC(bp)  GET_PREV_ALLOC(HDRP(bp))
+#endif
+
+/* Given block ptr bp, get value of it's foward and back pointer */
+#define FDP(bp)  (*(char **)(bp))
+#define BKP(bp)  (*(char **)((char *)(bp) + PSIZE))
+#define SET_FDP(bp, fdp) (FDP(bp) = (fdp))
+#define SET_BKP(bp, bkp) (BKP(bp) = (bkp))
+
+/* Given block ptr bp, get its treap links and subtree max for ORDER_ADDR, and its priority: a hash of the address */
+#define LEFT(bp)         (*(char **)(bp))
+#define RIGHT(bp)        (*(char **)((char *)(bp) + PSIZE))
+#define SUBTREE_MAX(bp)  (*(unsigned int *)((char *)(bp) + 2*PSIZE))
+#define PRIORITY(bp)  ((unsigned int)((uintptr_t)(bp) >> 3) * 2654435761u)
+
+/* Size class table: list of a block size */
+#define LOG2(size)  (31 - __builtin_clz((unsigned int)(size)))
+#if CLASSES == CLASSES_POW2
+#define NUM_LISTS         22      /* 16 bytes .. 32 MB */
+#define LIST_INDEX(size)  MIN(LOG2(size) - 4, NUM_LISTS - 1)
+#elif CLASSES == CLASSES_SEG4
+#define NUM_LISTS         88      /* 4 per power of two from 16 bytes, by the two bits below the top bit */
+#define LIST_INDEX(size)  MIN(4 * (LOG2(size) - 4) + (int)(((size) >> (LOG2(size) - 2)) & 3), NUM_LISTS - 1)
+#else
+#define NUM_LISTS         1
+#define LIST_INDEX(size)  0
+#endif
+
+/* Walking a list: the heap blocks for implicit lists, the links otherwise */
+#if CLASSES == CLASSES_IMPLICIT
+#define LIST_FIRST(i)    (heap_listp)
+#define LIST_NEXT(bp)    (GET_SIZE(HDRP(NEXT_BLKP(bp))) ? NEXT_BLKP(bp) : NULL)
+#define FITS(bp, asize)  (!GET_ALLOC(HDRP(bp)) && GET_SIZE(HDRP(bp)) >= (asize))
+#elif ORDER == ORDER_ADDR
+#define LIST_FIRST(i)    tree_fit(lists[i], NULL, 0)
+#define LIST_NEXT(bp)    tree_fit(lists[LIST_INDEX(GET_SIZE(HDRP(bp)))], (char *)(bp) + 1, 0)
+#define FITS(bp, asize)  (GET_SIZE(HDRP(bp)) >= (asize))
+#else
+#define LIST_FIRST(i)    (lists[i])
+#define LIST_NEXT(bp)    FDP(bp)
+#define FITS(bp, asize)  (GET_SIZE(HDRP(bp)) >= (asize))
+#endif
+
+/* A search stops after FIT_LIMIT fits, 0 means it looks at the whole list */
+#if FIT == FIT_FIRST
+#define FIT_LIMIT 1
+#elif FIT == FIT_GOOD
+#define FIT_LIMIT GOOD_FIT_K
+#else
+#define FIT_LIMIT 0
+#endif
+
+/* The rover of an implicit list must not point into a block that grew over it,
+   and the search goes on from the latest free block like the former mm_implicit_no_footer.c */
+#if CLASSES == CLASSES_IMPLICIT && FIT == FIT_NEXT
+#define FIX_ROVER(bp) do { if (rovers[0] > (char *)(bp) && rovers[0] < NEXT_BLKP(bp)) rovers[0] = (bp); } while (0)
+#define FREED(bp)     (rovers[0] = (bp))
+#else
+#define FIX_ROVER(bp)
+#define FREED(bp)
+#endif
+
+/* Global declarations */
+static char *heap_listp;          /* First block of the heap */
+#if CLASSES != CLASSES_IMPLICIT
+static char *lists[NUM_LISTS];    /* Free list heads */
+#endif
+#if FIT == FIT_NEXT
+static char *rovers[NUM_LISTS];   /* Where the next search of each list starts, NULL for its head */
+#endif
+
+/* Function prototypes for internal helper routines */
+static void *coalesce(char *bp);
+static void *extend_heap(size_t words);
+static void *find_fit(size_t asize);
+static char *search(int i, size_t asize);
+static void place(char *bp, size_t asize);
+static void realloc_place(char *bp, size_t size, size_t asize);
+static void set_alloc(char *bp, size_t size);
+static void set_free(char *bp, size_t size);
+static void insert(char *bp); /* insert a free block to its free list */
+static void delete(char *bp); /* delete a free block from its free list */
+#if CLASSES != CLASSES_IMPLICIT && ORDER == ORDER_ADDR
+static char *tree_insert(char *root, char *bp);
+static char *tree_delete(char *root, char *bp);
+static char *tree_merge(char *lo, char *hi);
+static char *tree_update(char *bp);
+static void tree_grow(char *root, char *bp);
+static char *tree_fit(char *root, char *lo, size_t asize);
+#endif
+static void mm_checkheap(int verbose);
+
+/*
+ * mm_init - initialize the malloc package.
+ */
+int mm_init(void)
+{
+    /* Create the initial empty heap */
+    if ((heap_listp = mem_sbrk(4*WSIZE)) == (void *) -1)
+        return -1;
+    PUT(heap_listp, 0);                             /* alignment padding */
+    PUT(heap_listp + (1*WSIZE), PACK(DSIZE, 3));    /* Prologue header */
+    PUT(heap_listp + (2*WSIZE), PACK(DSIZE, 3));    /* Prologue footer */
+    PUT(heap_listp + (3*WSIZE), PACK(0, 3));        /* Epilogue header */
+    heap_listp += 4*WSIZE;                          /* The first block starts there */
+
+    /* mdriver calls mm_init() once per trace, forget the old heap */
+#if CLASSES != CLASSES_IMPLICIT
+    memset(lists, 0, sizeof(lists));
+#endif
+#if FIT == FIT_NEXT
+    memset(rovers, 0, sizeof(rovers));
+#if CLASSES == CLASSES_IMPLICIT
+    rovers[0] = heap_listp;
+#endif
+#endif
+
+    /* Extend the empty heap with a free block of CHUNKSIZE bytes */
+    if (extend_heap(CHUNKSIZE/WSIZE) == NULL)
+        return -1;
+    return 0;
+}
+
+/*
+ * mm_malloc - Allocate a block by incrementing the brk pointer.
+ *             Always allocate a block whose size is a multiple of the alignment.
+ */
+void *mm_malloc(size_t size)
+{
+    DBG_PRINTF("Entering mm_malloc(%zu)\n", size);
+    CHECKHEAP(0);
+    size_t asize; /* Adjusted block size */
+    size_t extendsize; /* Amount to extend heap if not fit */
+    char *bp;
+
+    /* Ignore spurious requests */
+    if (size == 0) {
+        return NULL;
+    }
+
+    /* Adjust block size to include overhead and alignment reqs */
+    asize = ASIZE(size);
+
+    /* Search the free lists for a fit */
+    if ((bp = find_fit(asize)) != NULL) {
+        place(bp, asize);
+        return bp;
+    }
+
+    /* No fit. Get more memory and place the block */
+    extendsize = MAX(asize, CHUNKSIZE);
+    if ((bp = extend_heap(extendsize / WSIZE)) == NULL)
+        return NULL;
+    place(bp, asize);
+    return bp;
+}
+
+/*
+ * mm_free - Freeing a block and coalesce if necessary.
+ */
+void mm_free(void *bp)
+{
+    DBG_PRINTF("Entering mm_free(%p)\n", bp);
+    CHECKHEAP(0);
+    if (bp == NULL)
+        return;
+    coalesce(bp);
+}
+
+/*
+ * mm_realloc - Resize the block in place whenever its neighbours allow it:
+ *   1. Shrinking: split the tail off and free it.
+ *   2. Next block is free and big enough: absorb it.
+ *   3. Block (and a free next block) ends at the epilogue: extend the heap by the missing bytes only.
+ *   4. Previous block is free and big enough (together with a free next block): merge and memmove the payload down.
+ * Otherwise fall back to mm_malloc, memcpy and mm_free.
+ */
+void *mm_realloc(void *ptr, size_t size)
+{
+    size_t asize; /* Adjusted block size */
+    size_t oldsize, newsize;
+    char *prev_bp, *next_bp, *newptr;
+    size_t next_size;
+
+    if (ptr == NULL)
+        return mm_malloc(size);
+    if (size == 0) {
+        mm_free(ptr);
+        return NULL;
+    }
+
+    /* Adjust block size to include overhead and alignment reqs */
+    asize = ASIZE(size);
+
+    oldsize = GET_SIZE(HDRP(ptr));
+    next_bp = NEXT_BLKP(ptr);
+    next_size = GET_ALLOC(HDRP(next_bp)) ? 0 : GET_SIZE(HDRP(next_bp));
+
+    /* Case 1: shrink in place */
+    if (asize <= oldsize) {
+        realloc_place(ptr, oldsize, asize);
+        return ptr;
+    }
+
+    /* Case 2: grow into the free next block */
+    newsize = oldsize + next_size;
+    if (newsize >= asize) {
+        delete(next_bp);
+        realloc_place(ptr, newsize, asize);
+        return ptr;
+    }
+
+    /* Case 3: we are the last block (but a free one) before the epilogue, grow the heap by the delta */
+    if (GET_SIZE(HDRP(next_size ? NEXT_BLKP(next_bp) : next_bp)) == 0) {
+        if (mem_sbrk(asize - newsize) == (void *)-1)
+            return NULL;
+        if (next_size)
+            delete(next_bp);
+        PUT((char *)ptr + asize - WSIZE, PACK(0, 1)); /* New epilogue header */
+        set_alloc(ptr, asize);
+        return ptr;
+    }
+
+    /* Case 4: merge backwards, the payload moves down to the previous block */
+    if (!PREV_ALLOC(ptr)) {
+        prev_bp = PREV_BLKP(ptr);
+        newsize += GET_SIZE(HDRP(prev_bp));
+        if (newsize >= asize) {
+            delete(prev_bp);
+            if (next_size)
+                delete(next_bp);
+            memmove(prev_bp, ptr, oldsize - OVERHEAD);
+            realloc_place(prev_bp, newsize, asize);
+            return prev_bp;
+        }
+    }
+
+    /* No room around us, move the block */
+    newptr = mm_malloc(size);
+    if (newptr == NULL)
+        return NULL;
+    memcpy(newptr, ptr, oldsize - OVERHEAD);
+    mm_free(ptr);
+    return newptr;
+}
+
+/*
+ * mm_calloc - Allocate a zeroed block for nmemb elements of size bytes.
+ */
+void *mm_calloc(size_t nmemb, size_t size)
+{
+    void *bp;
+
+    if (nmemb != 0 && size > SIZE_MAX / nmemb)
+        return NULL;
+    size *= nmemb;
+    if ((bp = mm_malloc(size)) != NULL)
+        memset(bp, 0, size);
+    return bp;
+}
+
+/*
+ * mm_memalign - Allocate a block whose payload is aligned to alignment, a power of two.
+ *               Over-allocate, then give the gap in front of the aligned payload and the
+ *               tail behind the requested size back as free blocks.
+ */
+void *mm_memalign(size_t alignment, size_t size)
+{
+    size_t asize, gap;
+    char *bp, *abp;
+
+    if (size == 0 || (alignment & (alignment - 1)))
+        return NULL;
+    if (alignment <= ALIGNMENT)
+        return mm_malloc(size);
+
+    asize = ASIZE(size);
+    if ((bp = mm_malloc(asize + alignment + MINBLOCKSIZE)) == NULL)
+        return NULL;
+
+    /* The gap in front of the aligned payload must be able to hold a free block */
+    abp = (char *)(((uintptr_t)bp + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    if (abp != bp && abp - bp < MINBLOCKSIZE)
+        abp += alignment;
+    if (abp != bp) {
+        gap = abp - bp;
+        PUT(HDRP(abp), PACK(GET_SIZE(HDRP(bp)) - gap, 1));
+        set_free(bp, gap);
+        coalesce(bp);
+    }
+    realloc_place(abp, GET_SIZE(HDRP(abp)), asize);
+    return abp;
+}
+
+/*
+ * mm_posix_memalign - mm_memalign() with the POSIX interface: alignment must be a power
+ *                     of two multiple of sizeof(void *), errors are returned, not set in errno.
+ */
+int mm_posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *bp;
+
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)))
+        return EINVAL;
+    if (size == 0) {
+        *memptr = NULL;
+        return 0;
+    }
+    if ((bp = mm_memalign(alignment, size)) == NULL)
+        return ENOMEM;
+    *memptr = bp;
+    return 0;
+}
+
+/*
+ * mm_usable_size - Bytes of block bp the caller may use, up to its footer or the next header.
+ */
+size_t mm_usable_size(void *bp)
+{
+    return bp == NULL ? 0 : GET_SIZE(HDRP(bp)) - OVERHEAD;
+}
+
+/*
+ * mm_malloc_batch - Allocate n blocks of size bytes into out, one by one.
+ * Return: the number of blocks allocated, less than n if the heap is full.
+ */
+size_t mm_malloc_batch(size_t size, size_t n, void **out)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        if ((out[i] = mm_malloc(size)) == NULL)
+            break;
+    return i;
+}
+
+/*
+ * mm_free_batch - Free the n blocks of ptrs, one by one.
+ */
+void mm_free_batch(void **ptrs, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        mm_free(ptrs[i]);
+}
+
+/*
+ * mm_free_sized - The header already holds the block size, so this is mm_free().
+ */
+void mm_free_sized(void *ptr, size_t size)
+{
+    (void)size;
+    mm_free(ptr);
+}
+
+/*
+ * coalesce - Make bp a free block, merged with its free neighbours, and insert it.
+ *            A free previous block that stays in its list keeps its place there.
+ * Return: Pointer of the merged block.
+ */
+static void *coalesce(char *bp)
+{
+    DBG_PRINTF("Entering coalesce(%p)\n", bp);
+    char *next_bp = NEXT_BLKP(bp);
+    char *prev_bp;
+    size_t size = GET_SIZE(HDRP(bp));
+
+    if (!GET_ALLOC(HDRP(next_bp))) {
+        delete(next_bp);
+        size += GET_SIZE(HDRP(next_bp));
+    }
+    if (!PREV_ALLOC(bp)) {
+        prev_bp = PREV_BLKP(bp);
+        if (LIST_INDEX(size + GET_SIZE(HDRP(prev_bp))) == LIST_INDEX(GET_SIZE(HDRP(prev_bp)))) {
+            set_free(prev_bp, size + GET_SIZE(HDRP(prev_bp)));
+#if CLASSES != CLASSES_IMPLICIT && ORDER == ORDER_ADDR
+            tree_grow(lists[LIST_INDEX(GET_SIZE(HDRP(prev_bp)))], prev_bp);
+#endif
+            return prev_bp;
+        }
+        delete(prev_bp);
+        size += GET_SIZE(HDRP(prev_bp));
+        bp = prev_bp;
+    }
+    set_free(bp, size);
+    insert(bp);
+    return bp;
+}
+
+/*
+ * extend_heap - Extend the heap with a free block and coalesce the new free block if necessary.
+ * Return : new free block's payload address.
+ */
+static void *extend_heap(size_t words)
+{
+    char *bp;
+    size_t size;
+
+    /* Allocate a multiple of ALIGNMENT bytes to maintain alignment */
+    size = ALIGN(words * WSIZE);
+    if ((long)(bp = mem_sbrk(size)) == -1)
+        return NULL;
+
+    /* The old epilogue header becomes the new block's header, then comes a new epilogue */
+    set_free(bp, size);
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
+
+    /* Coalesce if the previous block was free */
+    return coalesce(bp);
+}
+
+/*
+ * find_fit - Search the list of the request's class, then the lists of bigger classes.
+ * Return: the block found, or NULL.
+ */
+static void *find_fit(size_t asize)
+{
+    DBG_PRINTF("Entering find_fit(%zu)\n", asize);
+    char *bp;
+
+    for (int i = LIST_INDEX(asize); i < NUM_LISTS; i++)
+        if ((bp = search(i, asize)) != NULL)
+            return bp;
+    return NULL;
+}
+
+/*
+ * search - Find a block of list i for asize bytes as the FIT policy says.
+ */
+static char *search(int i, size_t asize)
+{
+#if CLASSES != CLASSES_IMPLICIT && ORDER == ORDER_ADDR
+    /* Each step goes down the subtree maxima to the next fit, skipping the blocks that are too small */
+    char *bp;
+#if FIT == FIT_NEXT
+    /* From the rover on, then from the head: a fit at or above the rover would have turned up first */
+    if ((bp = tree_fit(lists[i], rovers[i], asize)) == NULL)
+        bp = tree_fit(lists[i], NULL, asize);
+    return bp != NULL ? (rovers[i] = bp) : NULL;
+#else
+    char *best = NULL;
+    int fits = 0;
+
+    for (bp = tree_fit(lists[i], NULL, asize); bp != NULL; bp = tree_fit(lists[i], bp + 1, asize)) {
+        if (best == NULL || GET_SIZE(HDRP(bp)) < GET_SIZE(HDRP(best)))
+            best = bp;
+        if (GET_SIZE(HDRP(bp)) == asize || ++fits == FIT_LIMIT)
+            break;
+    }
+    return best;
+#endif
+#else
+    char *bp, *next;
+#if FIT == FIT_NEXT
+    char *start = rovers[i] != NULL ? rovers[i] : LIST_FIRST(i);
+
+    /* From the rover to the end of the list, then from its head up to the rover */
+    for (bp = start; bp != NULL; bp = next) {
+        PREFETCH_BLK(next = LIST_NEXT(bp));
+        if (FITS(bp, asize))
+            return rovers[i] = bp;
+    }
+    for (bp = LIST_FIRST(i); bp != start; bp = next) {
+        PREFETCH_BLK(next = LIST_NEXT(bp));
+        if (FITS(bp, asize))
+            return rovers[i] = bp;
+    }
+    return NULL;
+#else
+    char *best = NULL;
+    int fits = 0;
+
+    for (bp = LIST_FIRST(i); bp != NULL; bp = next) {
+        PREFETCH_BLK(next = LIST_NEXT(bp));
+        if (!FITS(bp, asize))
+            continue;
+        if (best == NULL || GET_SIZE(HDRP(bp)) < GET_SIZE(HDRP(best)))
+            best = bp;
+        if (GET_SIZE(HDRP(bp)) == asize || ++fits == FIT_LIMIT)
+            break;
+    }
+    return best;
+#endif
+#endif
+}
+
+/*
+ * place - Place requested block in a free block, split if necessary.
+ */
+static void place(char *bp, size_t asize)
+{
+    DBG_PRINTF("Entering place(%p, %zu)\n", bp, asize);
+    delete(bp);
+    realloc_place(bp, GET_SIZE(HDRP(bp)), asize);
+}
+
+/*
+ * realloc_place - Make the (already unlinked) block bp of size bytes an allocated block of asize bytes,
+ *                 split the tail off and free it if it is big enough.
+ */
+static void realloc_place(char *bp, size_t size, size_t asize)
+{
+    DBG_PRINTF("Entering realloc_place(%p, %zu, %zu)\n", bp, size, asize);
+
+    if (size - asize >= MINBLOCKSIZE) {
+        set_alloc(bp, asize);
+        /* The tail may border a free block, so coalesce it */
+        set_free(NEXT_BLKP(bp), size - asize);
+        coalesce(NEXT_BLKP(bp));
+    }
+    else {
+        set_alloc(bp, size);
+    }
+}
+
+/*
+ * set_alloc - Write the boundary tags of bp as an allocated block of size bytes,
+ *             and tell the next block with FOOTERS_FREE.
+ */
+static void set_alloc(char *bp, size_t size)
+{
+#if FOOTERS == FOOTERS_ALL
+    PUT(HDRP(bp), PACK(size, 1));
+    PUT(FTRP(bp), PACK(size, 1));
+#else
+    PUT(HDRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp)) | 1));
+    SET_PREV_ALLOC(HDRP(NEXT_BLKP(bp)));
+#endif
+    FIX_ROVER(bp);
+}
+
+/*
+ * set_free - Write the boundary tags of bp as a free block of size bytes, and tell the next
+ *            block with FOOTERS_FREE. The P bit of bp's header is kept.
+ */
+static void set_free(char *bp, size_t size)
+{
+#if FOOTERS == FOOTERS_ALL
+    unsigned int prev_alloc = 0;
+#else
+    unsigned int prev_alloc = GET_PREV_ALLOC(HDRP(bp));
+#endif
+
+    PUT(HDRP(bp), PACK(size, prev_alloc));
+    PUT(FTRP(bp), PACK(size, prev_alloc));
+#if FOOTERS == FOOTERS_FREE
+    CLR_PREV_ALLOC(HDRP(NEXT_BLKP(bp)));
+#endif
+    FREED(bp);
+}
+
+/*
+ * insert - Insert free block bp into the list of its size: at the head, or into the treap.
+ */
+static void insert(char *bp)
+{
+#if CLASSES != CLASSES_IMPLICIT && ORDER == ORDER_ADDR
+    int i = LIST_INDEX(GET_SIZE(HDRP(bp)));
+
+    lists[i] = tree_insert(lists[i], bp);
+#elif CLASSES != CLASSES_IMPLICIT
+    int i = LIST_INDEX(GET_SIZE(HDRP(bp)));
+    char *next = lists[i];
+
+    SET_FDP(bp, next);
+    SET_BKP(bp, NULL);
+    lists[i] = bp;
+    if (next != NULL)
+        SET_BKP(next, bp);
+#endif
+}
+
+/*
+ * delete - Remove free block bp from its list, its header must still hold the size it was inserted with.
+ */
+static void delete(char *bp)
+{
+#if CLASSES != CLASSES_IMPLICIT
+    int i = LIST_INDEX(GET_SIZE(HDRP(bp)));
+
+#if FIT == FIT_NEXT
+    if (rovers[i] == bp)
+        rovers[i] = LIST_NEXT(bp);
+#endif
+#if ORDER == ORDER_ADDR
+    lists[i] = tree_delete(lists[i], bp);
+#else
+    if (BKP(bp) != NULL)
+        SET_FDP(BKP(bp), FDP(bp));
+    else
+        lists[i] = FDP(bp);
+    if (FDP(bp) != NULL)
+        SET_BKP(FDP(bp), BKP(bp));
+#endif
+#endif
+}
+
+#if CLASSES != CLASSES_IMPLICIT && ORDER == ORDER_ADDR
+/*
+ * tree_insert - Insert free block bp into the treap at root as a leaf, rotated up while its priority beats
+ *               its parent's.
+ * Return: the new root.
+ */
+static char *tree_insert(char *root, char *bp)
+{
+    char *child;
+
+    if (root == NULL) {
+        LEFT(bp) = RIGHT(bp) = NULL;
+        return tree_update(bp);
+    }
+    if (bp < root) {
+        child = LEFT(root) = tree_insert(LEFT(root), bp);
+        if (PRIORITY(child) > PRIORITY(root)) {
+            LEFT(root) = RIGHT(child);
+            RIGHT(child) = tree_update(root);
+            return tree_update(child);
+        }
+    }
+    else {
+        child = RIGHT(root) = tree_insert(RIGHT(root), bp);
+        if (PRIORITY(child) > PRIORITY(root)) {
+            RIGHT(root) = LEFT(child);
+            LEFT(child) = tree_update(root);
+            return tree_update(child);
+        }
+    }
+    return tree_update(root);
+}
+
+/*
+ * tree_delete - Remove free block bp from the treap at root, its children take its place.
+ * Return: the new root.
+ */
+static char *tree_delete(char *root, char *bp)
+{
+    if (root == bp)
+        return tree_merge(LEFT(bp), RIGHT(bp));
+    if (bp < root)
+        LEFT(root) = tree_delete(LEFT(root), bp);
+    else
+        RIGHT(root) = tree_delete(RIGHT(root), bp);
+    return tree_update(root);
+}
+
+/*
+ * tree_merge - Join treaps lo and hi, every node of lo lying below every node of hi.
+ * Return: the root of the joined treap.
+ */
+static char *tree_merge(char *lo, char *hi)
+{
+    if (lo == NULL)
+        return hi;
+    if (hi == NULL)
+        return lo;
+    if (PRIORITY(lo) > PRIORITY(hi)) {
+        RIGHT(lo) = tree_merge(RIGHT(lo), hi);
+        return tree_update(lo);
+    }
+    LEFT(hi) = tree_merge(lo, LEFT(hi));
+    return tree_update(hi);
+}
+
+/*
+ * tree_update - Recompute the subtree max of node bp from its own size and its children's.
+ * Return: bp.
+ */
+static char *tree_update(char *bp)
+{
+    unsigned int max = GET_SIZE(HDRP(bp));
+
+    if (LEFT(bp) != NULL)
+        max = MAX(max, SUBTREE_MAX(LEFT(bp)));
+    if (RIGHT(bp) != NULL)
+        max = MAX(max, SUBTREE_MAX(RIGHT(bp)));
+    SUBTREE_MAX(bp) = max;
+    return bp;
+}
+
+/*
+ * tree_grow - Raise the subtree maxima on the path from root down to node bp, which grew in place.
+ */
+static void tree_grow(char *root, char *bp)
+{
+    for (;;) {
+        SUBTREE_MAX(root) = MAX(SUBTREE_MAX(root), GET_SIZE(HDRP(bp)));
+        if (root == bp)
+            return;
+        root = bp < root ? LEFT(root) : RIGHT(root);
+    }
+}
+
+/*
+ * tree_fit - The lowest block at or above lo of at least asize bytes in the treap at root, NULL if none.
+ *            Subtrees whose max is below asize are skipped whole, so it costs O(log n) expected.
+ */
+static char *tree_fit(char *root, char *lo, size_t asize)
+{
+    char *bp;
+
+    if (root == NULL || SUBTREE_MAX(root) < asize)
+        return NULL;
+    if (root >= lo) {
+        if ((bp = tree_fit(LEFT(root), lo, asize)) != NULL)
+            return bp;
+        if (GET_SIZE(HDRP(root)) >= asize)
+            return root;
+    }
+    return tree_fit(RIGHT(root), lo, asize);
+}
+#endif
+
+/*
+ * mm_checkheap - Check the boundary tags of every block and that the free lists hold
+ *                exactly the free blocks, each in the list of its size and in order.
+ */
+static void mm_checkheap(int verbose)
+{
+    size_t heap_free = 0, list_free = 0;
+    char *bp;
+
+    for (bp = heap_listp; GET_SIZE(HDRP(bp)) != 0; bp = NEXT_BLKP(bp)) {
+        if ((unsigned long)bp % ALIGNMENT || GET_SIZE(HDRP(bp)) < MINBLOCKSIZE) {
+            printf("Block %p(size: %u) misaligned or too small!\n", bp, GET_SIZE(HDRP(bp)));
+            exit(1);
+        }
+        if ((!GET_ALLOC(HDRP(bp)) || FOOTERS == FOOTERS_ALL) && GET(HDRP(bp)) != GET(FTRP(bp))) {
+            printf("Header and footer mismatch at %p\n", bp);
+            exit(1);
+        }
+        if (FOOTERS == FOOTERS_FREE && !GET_PREV_ALLOC(HDRP(NEXT_BLKP(bp))) != !GET_ALLOC(HDRP(bp))) {
+            printf("Prev alloc bit of %p out of sync!\n", NEXT_BLKP(bp));
+            exit(1);
+        }
+        if (!GET_ALLOC(HDRP(bp))) {
+            heap_free++;
+            if (!GET_ALLOC(HDRP(NEXT_BLKP(bp)))) {
+                printf("Adjacent free blocks at %p!\n", bp);
+                exit(1);
+            }
+        }
+        if (verbose)
+            printf("%p(size: %u, alloc: %u)\n", bp, GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)));
+    }
+
+#if CLASSES == CLASSES_IMPLICIT
+    list_free = heap_free;
+#else
+    for (int i = 0; i < NUM_LISTS; i++) {
+        for (bp = LIST_FIRST(i); bp != NULL; bp = LIST_NEXT(bp)) {
+            list_free++;
+            if (GET_ALLOC(HDRP(bp)) || LIST_INDEX(GET_SIZE(HDRP(bp))) != i) {
+                printf("Block %p(size: %u) does not belong to list %d!\n", bp, GET_SIZE(HDRP(bp)), i);
+                exit(1);
+            }
+#if ORDER == ORDER_ADDR
+            /* Children do not beat our priority, the subtree max is right, the walk goes up in address */
+            unsigned int max = GET_SIZE(HDRP(bp));
+            if (LEFT(bp) != NULL)
+                max = MAX(max, SUBTREE_MAX(LEFT(bp)));
+            if (RIGHT(bp) != NULL)
+                max = MAX(max, SUBTREE_MAX(RIGHT(bp)));
+            if ((LEFT(bp) != NULL && PRIORITY(LEFT(bp)) > PRIORITY(bp))
+                || (RIGHT(bp) != NULL && PRIORITY(RIGHT(bp)) > PRIORITY(bp))
+                || SUBTREE_MAX(bp) != max || (LIST_NEXT(bp) != NULL && LIST_NEXT(bp) < bp)) {
+#else
+            if (FDP(bp) != NULL && BKP(FDP(bp)) != bp) {
+#endif
+                printf("List %d broken at %p!\n", i, bp);
+                exit(1);
+            }
+        }
+    }
+#endif
+    if (heap_free != list_free) {
+        printf("%zu free blocks in the heap, %zu in the lists!\n", heap_free, list_free);
+        exit(1);
+    }
+}
@@ -10,22 +10,31 @@
     fragmented chunks into bigger chunks very fast. The size fields
     also hold bits representing whether chunks are free or in use.
 
-    An allocated chunk looks like this:
+    Only free chunks need a footer: the P (PREV_ALLOCATED) bit in every
+    header tells whether the previous chunk is in use, and the footer
+    of the previous chunk is only read when it is free. So an allocated
+    chunk looks like this, its last word is user data:
     
         header-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-
-	    |             Size of chunk, in bytes                         |A|
+	    |             Size of chunk, in bytes                     |R|P|A|
         mem-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 	    |             User data starts here...                          .
 	    .                                                               .
 	    .                                                               .
 	    .                                                               |
-        footer-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-
-	    |             Same as header(`boundary tag`)                  |A|
 	    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 
     "header" is the front of the chunk for the purpose of most of the
     malloc code, but "mem" is the pointer that is returned to the user. 
 
+    The R (REALLOCED) bit marks a chunk that realloc has already grown.
+    When a marked chunk grows again it is made 1.5 times the request
+    (REALLOC_SLACK) if it has to move or its neighbours have the room,
+    and later reallocs that fit in the slack keep it instead of
+    splitting it off, so a buffer grown step by step is copied O(log n)
+    times instead of on every step. At the end of the heap no slack is
+    taken, the heap grows by grow_size() instead.
+
     Chunks always begin on even word boundaries, so the mem portion
     (which is returned to the user) is also on an even word boundary, and
     thus at least double-word aligned.
@@ -33,7 +42,7 @@
     Free chunks are stored in doubly-linked lists, and look like this:
 
         header-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-
-	    |             Size of chunk, in bytes                         |A|
+	    |             Size of chunk, in bytes                       |P|A|
         mem-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 	    |             Forward pointer to next chunk in free list        |
 	    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
@@ -46,23 +55,29 @@
 	    |             Same as header(`boundary tag`)                  |A|
 	    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
     
+    The forward and back "pointers" are 32 bit offsets from the heap
+    start (mem_heap_lo()), 0 meaning NULL, so a free chunk needs only
+    16 bytes on 64bit builds too, as long as the heap stays below 4 GB.
+    Build with -DPTR_LINKS to store raw pointers instead.
+
     The A (ALLOCATED) bit is set for prologue and epilogue block to help
-    determine block's boundary.
+    determine block's boundary. The P bit of a free chunk is always set,
+    since its previous chunk is never free after coalescing.
     Prologue and epilogue block's size are set to 0.
    
    Heap structure:
-        heap start-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-
-        |                 4 btes padding                  |
         free list heads-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-        | Free list's head address(request size <= 8)     |
+        | Free list's head address(16 <= size < 20)       |
         +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-        | Free list's head address(request size <= 16)    |
+        | Free list's head address(20 <= size < 24)       |
         +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
         |                                                 .
-        .    Same as above, request size <= power of 2    .
+        .    Same as above, 4 classes per power of 2      .
         .                                                 |
         +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-	    | Free list's head address(request size > 4096)   |
+	    | Free list's head address(3584 <= size < 4096)   |
+        +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+        |          padding for alignment                  |
         prologue header-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
         |             Size of chunk, in bytes           |A|
         prologue footer->-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
@@ -76,9 +91,91 @@
         +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
     
     The free list head stores the starting address of each
-    free list for differnt size classes, from lower than 8
-    byts to bigger than 4096 bytes.
-    We have 10 free list entry, so no padding is needed.
+    free list for differnt size classes. Each power of two from 16
+    bytes up is split into 4 classes by the two bits below its top bit,
+    so LIST_OFFSET() is a `clz' and a few shifts instead of a chain of
+    compares. We have NUM_CLASSES (32) free list entries, for blocks
+    below TREE_MIN (4 KB).
+    Free blocks of TREE_MIN bytes and more are kept in a treap (a
+    Cartesian tree) ordered by size, then address, whose priorities are
+    a hash of the address: the three link words of a node hold its left
+    child, right child and parent. find_fit() takes the best fit from
+    it, and inserting or deleting a node costs O(log n) expected.
+    A 64 bit bitmap (outside the heap) marks the non-empty lists, so
+    find_fit() skips empty classes with one `ctz'. In asize's own class
+    it takes the tightest of the first GOOD_FIT_K blocks that fit,
+    stopping at an exact fit; any block of a bigger class fits.
+    Build with -DADDR_ORDER to keep each class in address order instead
+    of LIFO: the class is then a treap ordered by address (the same
+    priorities, two link words holding the children and a third word
+    the largest size in the subtree, which raises MINBLOCKSIZE by one
+    link), so insert() and delete() stay O(log n) expected, and
+    find_fit() follows the subtree maxima down to the lowest fitting
+    block of asize's class, or takes the lowest block of a bigger class.
+
+    The free block at the end of the heap is the top chunk (arena->top,
+    NULL while the last block is allocated). insert() and delete() keep
+    it out of the free lists and the tree, so a request is served from
+    it only when no other free block fits: the top is cut by moving its
+    start up past the new block, and older fragments are used before
+    the heap end is broken up. extend_heap() grows the top in place
+    instead of coalescing a new block, and trim() cuts it back.
+
+    place() cuts blocks of PLACE_HIGH_MIN bytes or more from the high
+    end of the free block it splits, smaller ones from the low end. In
+    a pattern of short-lived small blocks between long-lived big ones,
+    the small ones then sit side by side and free a single hole.
+
+    Requests of at most SLAB_MAX (64) bytes never get a chunk of their
+    own. They are served from slab runs: 4 KB allocated chunks, starting
+    on a 4 KB boundary of the heap, cut into objects of one size class
+    (multiples of ALIGNMENT) with no per-object header. The run header
+    holds the class and a bitmap of free objects. A page map outside the
+    heap marks the pages where runs start, so mm_free() tells a slab
+    object from a chunk by its address alone. Empty runs are given back
+    as ordinary free chunks, except the last partial run of a class.
+
+    Freed chunks of up to FASTBIN_MAX bytes are not coalesced right
+    away. They go to a fastbin, a LIFO list per chunk size linked
+    through the first payload word, and keep their A bit set, so no
+    neighbour merges with them and a request of the same size pops
+    them back without touching any free list. The fastbins hold at
+    most FASTBIN_CONSOLIDATE bytes. consolidate() frees all fastbin
+    chunks for real when a request finds no fit (before the heap
+    grows), or when a free builds a chunk of FASTBIN_CONSOLIDATE bytes
+    or more or the last chunk of the heap, so the heap end can still be
+    trimmed.
+
+    mm_calloc() only clears what lies below mem_heap_fresh(): memory
+    above it has never been handed out and is still zero, apart from
+    the words that extending the heap wrote into the new free chunk.
+    mm_memalign() takes a chunk with room for the alignment and gives
+    the gap in front of the aligned payload back as a free chunk.
+
+    mm_malloc_batch() finds one free block for all its chunks (up to
+    BATCH_MAX bytes) and carves them side by side, falling back to
+    mm_malloc() when there is none, and mm_free_batch()
+    sorts its pointers so that neighbouring chunks are merged into one
+    block before that is coalesced with the heap.
+
+    mm_free_sized() trusts the size of the request: more than SLAB_MAX
+    bytes means a chunk, so the page map is only consulted for small
+    sizes, where a chunk from mm_memalign() may hide behind a slab
+    size. realloc() moves chunks shrinking to slab sizes to a slab
+    object, so only such chunks do. The size is checked against the
+    block only when HEAP_CHECK is on (-DHEAP_CHECK=1).
+
+    Requests of MMAP_THRESHOLD bytes or more do not touch the heap: each
+    gets a mapping of its own from mem_map(), handed back whole by
+    mem_unmap() on free, so a freed big buffer leaves no hole for small
+    requests to break up. The two words in front of the payload hold
+    the offset of the payload in the mapping and, where a chunk has its
+    header, the size of the mapping. A block is mapped iff it lies
+    outside the heap's region. realloc() keeps a mapped block while the
+    size fits, otherwise grows the mapping with mem_remap() (mremap(),
+    which may move the pages but copies nothing), and moves it back to
+    the heap when it shrinks below MMAP_THRESHOLD. A heap chunk growing
+    to MMAP_THRESHOLD or more moves to a mapping.
  */
 
 #include <stddef.h>
@@ -87,9 +184,16 @@
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#ifdef THREADED
+#include <pthread.h>
+#endif
 
 #include "mm.h"
 #include "memlib.h"
+#include "config.h"
+#include "mm_tags.h"
 
 /*********************************************************
  * NOTE TO STUDENTS: Before you do anything else, please
@@ -111,7 +215,9 @@ team_t team = {
   Debugging macros:
 */
 #define DEBUG 0
+#ifndef HEAP_CHECK
 #define HEAP_CHECK 0
+#endif
 
 #if DEBUG == 1
 # define DBG_PRINTF(...) printf(__VA_ARGS__)
@@ -121,122 +227,323 @@ team_t team = {
 
 #if HEAP_CHECK == 1
 #define CHECKHEAP(verbose) mm_checkheap(verbose)
+#define CHECKSIZE(bp, size) check_size(bp, size)
 #else
 #define CHECKHEAP(verbose) 
+#define CHECKSIZE(bp, size)
+#endif
+
+/* Basic constants, the boundary tag macros are in mm_tags.h */
+#define CHUNKSIZE  (1<<12)    /* Initial heap size and smallest heap extension (bytes) */
+#define GROW_GUARD 32         /* The growth step never exceeds 1/GROW_GUARD of the heap */
+
+/* A free block at the end of the heap reaching TRIM_THRESHOLD bytes is cut back to TRIM_PAD bytes */
+#ifndef TRIM_THRESHOLD
+#define TRIM_THRESHOLD  (128*1024)
 #endif
+#define TRIM_PAD        CHUNKSIZE
 
+/* Blocks of PLACE_HIGH_MIN bytes and more are cut from the high end of a free block, smaller ones from the low end */
+#ifndef PLACE_HIGH_MIN
+#define PLACE_HIGH_MIN  256
+#endif
 
-/* 8 bytes alignment in 32bit mode */
-#define ALIGNMENT 8
+/* A search of asize's own class takes the tightest of the first GOOD_FIT_K blocks that fit, 1 is first fit, 0 all */
+#ifndef GOOD_FIT_K
+#define GOOD_FIT_K  4
+#endif
 
-/* Rounds up to the nearest multiple of ALIGNMENT */
-#define ALIGN(size) (((size) + (ALIGNMENT-1)) & ~0x7)
+/* With PREFETCH 1 find_fit() prefetches the header of the next block of a class while it looks at the current one */
+#ifndef PREFETCH
+#define PREFETCH  0
+#endif
 
-//* Basic constants and macros: */
-#define WSIZE      4          /* Word and header/footer size (bytes) */
-#define DSIZE      8          /* Doubleword size (bytes) */
-#define CHUNKSIZE  (1<<12)    /* Extend heap by this amount (bytes) */
-#define MINBLOCKSIZE 16       /* Minimum block size: WORD(HDR) + WORD(FDP) + WORD(BKP) + WORD(FTR) */
+/* Requests of MMAP_THRESHOLD bytes and more get a mapping of their own */
+#ifndef MMAP_THRESHOLD
+#define MMAP_THRESHOLD  (128*1024)
+#endif
+#ifdef ADDR_ORDER
+#define MINBLOCKSIZE ALIGN(DSIZE + 3 * LSIZE) /* Minimum block size: WORD(HDR) + LINK(LEFT) + LINK(RIGHT) + WORD(MAX) + WORD(FTR) */
+#else
+#define MINBLOCKSIZE ALIGN(DSIZE + 2 * LSIZE) /* Minimum block size: WORD(HDR) + LINK(FDP) + LINK(BKP) + WORD(FTR) */
+#endif
 #define ALLOCATED 1
 #define UNALLOCATED 0
 
-/* Max value of 2 values */
-#define MAX(x, y) ((x) > (y) ? (x) : (y))
+/* Read and set the realloced status at address p, writing a header with PACK() clears it */
+#define GET_REALLOC(p)  (GET(p) & 0x4)
+#define SET_REALLOC(p)  (PUT(p, GET(p) | 0x4))
 
-/* Pack a size and allocated bit into a word */
-#define PACK(size, alloc)  ((size) | (alloc))
+/* Block size a chunk realloc grows for the second time gets, keeping slack for the next growths */
+#define REALLOC_SLACK(asize)  ALIGN((asize) + (asize) / 2)
 
-/* Read and write a word at address p. */
-#define GET(p)       (*(unsigned int *)(p))
-#define PUT(p, val)  (*(unsigned int *)(p) = (val))
+/* Mapped blocks: offset of the payload in the mapping, its start and the bytes usable from bp */
+#define MAP_OFFSET(bp)  GET((char *)(bp) - DSIZE)
+#define MAP_START(bp)   ((char *)(bp) - MAP_OFFSET(bp))
+#define MAP_USABLE(bp)  (GET_SIZE(HDRP(bp)) - MAP_OFFSET(bp))
 
-/* Read the size and allocated fields from address p */
-#define GET_SIZE(p)   (GET(p) & ~0x7)
-#define GET_ALLOC(p)  (GET(p) & 0x1)
+#ifdef PTR_LINKS
+#define LSIZE  PSIZE          /* Free list link size (bytes) */
 
-/* Given block ptr bp, compute address of its header and footer */
-#define HDRP(bp)  ((char *)(bp) - WSIZE)
-#define FTRP(bp)  ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
+/* Read and write a link to a free block at address p */
+#define GET_LINK(p)     (*(char **)(p))
+#define SET_LINK(p, q)  (*(char **)(p) = (q))
+#else
+#define LSIZE  WSIZE          /* Free list link size (bytes) */
+
+/* Convert between a block ptr and its offset from the heap start, NULL is offset 0 */
+#define TO_OFFSET(p)  ((p) ? (unsigned int)((char *)(p) - arena->seglist_start) : 0)
+#define TO_PTR(off)   ((off) ? arena->seglist_start + (off) : NULL)
+
+/* Read and write a link to a free block at address p */
+#define GET_LINK(p)     TO_PTR(GET(p))
+#define SET_LINK(p, q)  PUT(p, TO_OFFSET(q))
+#endif
 
 /* Given block ptr bp, get value of foward and back pointer of that chunk (note those are different from HDRP() adn FTRP()) */
-#define FDP(bp)  (*(char **)(bp))
-#define BKP(bp)  (*(char **)(bp + WSIZE))
+#define FDP(bp)  GET_LINK(bp)
+#define BKP(bp)  GET_LINK((char *)(bp) + LSIZE)
 
 /* Given block ptr bp, set forward and back pointer's value of that block by given value*/
-#define SET_FDP(bp, fdp) (FDP(bp) = fdp)
-#define SET_BKP(bp, bkp) (BKP(bp) = bkp)
+#define SET_FDP(bp, fdp) SET_LINK(bp, fdp)
+#define SET_BKP(bp, bkp) SET_LINK((char *)(bp) + LSIZE, bkp)
 
-/* Given block ptr bp, compute address of next and previous blocks */
-#define NEXT_BLKP(bp)  ((char *)(bp) + GET_SIZE(HDRP(bp)))
-#define PREV_BLKP(bp)  ((char *)(bp) - GET_SIZE((char *)(bp) - DSIZE))
+/* Free blocks of at least TREE_MIN bytes are tree nodes instead: left child, right child and parent links */
+#define LEFT(bp)    GET_LINK(bp)
+#define RIGHT(bp)   GET_LINK((char *)(bp) + LSIZE)
+#define PARENT(bp)  GET_LINK((char *)(bp) + 2*LSIZE)
+#define SET_LEFT(bp, p)    SET_LINK(bp, p)
+#define SET_RIGHT(bp, p)   SET_LINK((char *)(bp) + LSIZE, p)
+#define SET_PARENT(bp, p)  SET_LINK((char *)(bp) + 2*LSIZE, p)
 
-/* Given block size, compute the free list offset */
+/* ADDR_ORDER treap nodes keep the largest block size of their subtree where tree nodes keep the parent */
+#define SUBTREE_MAX(bp)          GET((char *)(bp) + 2*LSIZE)
+#define SET_SUBTREE_MAX(bp, sz)  PUT((char *)(bp) + 2*LSIZE, sz)
+
+/* Size classes: 1 << CLASS_SHIFT classes per power of two, starting at MINBLOCKSIZE, up to TREE_MIN */
+#define NUM_CLASSES     32
+#define CLASS_SHIFT     2
+#define MIN_CLASS_LOG2  4     /* log2(MINBLOCKSIZE) */
+#define TREE_MIN        (1 << (MIN_CLASS_LOG2 + (NUM_CLASSES >> CLASS_SHIFT))) /* 4096 */
+
+/* Index of the highest set bit of a non-zero word */
+#define FLS(x)  (31 - __builtin_clz((unsigned int)(x)))
+
+/* Given block size below TREE_MIN, compute the free list offset: the power of two picks a group of classes,
+ * the CLASS_SHIFT bits below the top bit pick the class in the group. */
 #define LIST_OFFSET(size) \
-    (size <= 16   ? 0 :\
-     size <= 32   ? 1 :\
-     size <= 64   ? 2 :\
-     size <= 128  ? 3 :\
-     size <= 256  ? 4 :\
-     size <= 512  ? 5 :\
-     size <= 1024 ? 6 :\
-     size <= 2048 ? 7 :\
-     size <= 4096 ? 8 :\
-     9)
-
-/* Global declarations */
-static char *heap_listp;
-static char *seglist_start;
-static char *freelist_headp;
+    (((FLS(size) - MIN_CLASS_LOG2) << CLASS_SHIFT) + \
+     (((size) >> (FLS(size) - CLASS_SHIFT)) & ((1 << CLASS_SHIFT) - 1)))
+
+/* Tree order: by size, then by address. Heap order: a node's priority, a hash of its address,
+ * is not below its children's, which keeps the tree balanced in expectation (a treap). */
+#define TREE_LESS(a, b)  (GET_SIZE(HDRP(a)) < GET_SIZE(HDRP(b)) || \
+                          (GET_SIZE(HDRP(a)) == GET_SIZE(HDRP(b)) && (char *)(a) < (char *)(b)))
+#define PRIORITY(bp)     ((unsigned int)((unsigned long)(bp) >> 3) * 2654435761u)
+
+/* Address of the head pointer of free list i */
+#define SEGLIST_HEADP(i)  ((char **)arena->seglist_start + (i))
+
+/* Slab tier: requests up to SLAB_MAX bytes live in page sized runs of one object size, without headers */
+#define SLAB_MAX       64
+#define SLAB_RUNSIZE   (1<<12)                     /* Run size, runs start on a RUNSIZE boundary of the heap */
+#define SLAB_CLASSES   (SLAB_MAX / ALIGNMENT)      /* Object sizes ALIGNMENT, 2*ALIGNMENT, ..., SLAB_MAX */
+#define SLAB_MAPWORDS  (SLAB_RUNSIZE / ALIGNMENT / 32)
+
+/* Slab class of a request and object size of a class */
+#define SLAB_CLASS(size)  (((size) - 1) / ALIGNMENT)
+#define SLAB_OBJSIZE(c)   (((c) + 1) * ALIGNMENT)
+
+/* First object of a run and objects per run, the last word of a run is the next block's header */
+#define SLAB_OBJS(run)    ((char *)(run) + ALIGN(sizeof(slab_run_t)))
+#define SLAB_NOBJS(c)     ((SLAB_RUNSIZE - WSIZE - ALIGN(sizeof(slab_run_t))) / SLAB_OBJSIZE(c))
+
+/* Heap page of address p, and whether a slab run starts on it */
+#define SLAB_PAGE(p)      ((unsigned int)(((char *)(p) - arena->seglist_start) / SLAB_RUNSIZE))
+#define IS_SLAB(p)        ((arena->slab_pages[SLAB_PAGE(p) / 32] >> (SLAB_PAGE(p) % 32)) & 1)
+#define SLAB_RUN(p)       ((slab_run_t *)(arena->seglist_start + (size_t)SLAB_PAGE(p) * SLAB_RUNSIZE))
+
+/* Run header, at the start of the run's payload */
+typedef struct slab_run {
+    struct slab_run *next;           /* Next run of the class with free objects */
+    struct slab_run *prev;           /* Previous run of the class with free objects */
+    unsigned int cls;                /* Slab class */
+    unsigned int nfree;              /* Number of free objects */
+    unsigned int map[SLAB_MAPWORDS]; /* Bit i set <=> object i is free */
+} slab_run_t;
+
+/* Fastbins: freed chunks of MINBLOCKSIZE to FASTBIN_MAX bytes are cached, still marked allocated, one list per size */
+#define FASTBIN_MAX          512
+#define FASTBINS             ((FASTBIN_MAX - MINBLOCKSIZE) / ALIGNMENT + 1)
+#define FASTBIN_INDEX(size)  (((size) - MINBLOCKSIZE) / ALIGNMENT)
+#define FASTBIN_CONSOLIDATE  (64*1024) /* Freeing into a chunk this big flushes the fastbins */
+
+/* mm_malloc_batch() carves its blocks from free blocks of at most BATCH_MAX bytes (or one block) */
+#define BATCH_MAX  (64*1024)
+
+/*
+ * Bytes in front of the prologue header: free list heads, padded so that payloads stay aligned.
+ * Prologue header, prologue footer and epilogue header take 3 words before the first payload.
+ */
+#define SEGLIST_SIZE  (ALIGN(NUM_CLASSES * PSIZE + 3*WSIZE) - 3*WSIZE)
+
+/* Allocator state, one per arena */
+typedef struct {
+    char *heap_listp;
+    char *seglist_start;   /* Heap start, base of free list link offsets */
+    char *freelist_headp;
+    unsigned long long seglist_bitmap; /* bit i set <=> free list i is non-empty */
+    char *tree_root;       /* Tree of the free blocks of at least TREE_MIN bytes */
+    char *top;             /* Free last block of the heap, in no free list, NULL if the last block is allocated */
+    size_t grow_step;      /* Bytes the next heap extension asks for at least */
+    char *fastbins[FASTBINS];          /* Freed but not coalesced chunks, per size */
+    unsigned long long fastbin_bitmap; /* bit i set <=> fastbin i is non-empty */
+    size_t fastbin_bytes;              /* Total size of the fastbin chunks */
+    slab_run_t *slab_partial[SLAB_CLASSES];   /* Runs with free objects, per slab class */
+    unsigned int slab_pages[MAX_HEAP / SLAB_RUNSIZE / 32 + 1]; /* bit i set <=> heap page i starts a run */
+#ifdef THREADED
+    char *region_lo;       /* First byte of the arena's memlib region, set by mm_init() */
+    pthread_mutex_t lock;  /* Held while working on the arena */
+#endif
+} arena_t;
+
+#ifdef THREADED
+/*
+ * Threaded mode: NUM_ARENAS arenas, arena i lives in memlib region i and has its own lock.
+ * Threads are spread over the arenas round robin. Freed blocks of up to TCACHE_MAX bytes
+ * first go to a per-thread cache with one list per block size, which mm_malloc() serves
+ * without any lock; only cache misses and overflows lock an arena.
+ */
+#define NUM_ARENAS   MEM_REGIONS
+#define TCACHE_MAX   1024      /* Biggest cached block (bytes) */
+#define TCACHE_COUNT 16        /* Blocks per cache list */
+#define TCACHE_BINS  (TCACHE_MAX / ALIGNMENT + 1)
+
+/* Cache list of a slab class (small requests) or of a block size: block sizes of chunks always exceed SLAB_MAX */
+#define TCACHE_SLAB_BIN(cls)    (cls)
+#define TCACHE_BLOCK_BIN(size)  ((size) <= TCACHE_MAX ? (int)((size) / ALIGNMENT) : -1)
+
+/* Per-thread cache, stale once mm_init() bumped the epoch */
+typedef struct {
+    unsigned int epoch;
+    arena_t *home;                   /* Arena this thread allocates from */
+    void *head[TCACHE_BINS];         /* Cached blocks, linked through their first word */
+    unsigned char count[TCACHE_BINS];
+} tcache_t;
+
+static arena_t arenas[NUM_ARENAS];
+static unsigned int epoch;           /* Bumped by mm_init() */
+static unsigned int next_arena;      /* Round robin arena assignment */
+static __thread arena_t *arena;      /* Arena the running operation works on */
+static __thread tcache_t tcache;
+
+#define ARENA_SBRK(incr)  mem_region_sbrk(arena - arenas, incr)
+#define ARENA_HEAP_HI()   mem_region_hi(arena - arenas)
+#define ARENA_FRESH()     ((char *)mem_region_fresh(arena - arenas))
+#define ARENA_LO()        (arena->region_lo)
+#else
+static arena_t arena_0;
+#define arena (&arena_0)
+
+#define ARENA_SBRK(incr)  mem_sbrk(incr)
+#define ARENA_HEAP_HI()   mem_heap_hi()
+#define ARENA_FRESH()     ((char *)mem_heap_fresh())
+#define ARENA_LO()        ((char *)mem_heap_lo())
+#endif
+
+/* Blocks outside the arena's region have a mapping of their own */
+#define IS_MAPPED(bp)     ((size_t)((char *)(bp) - ARENA_LO()) >= MAX_HEAP)
 
 /* Function prototypes for internal helper routines */
 static void *coalesce(void *bp);
 static void *extend_heap(size_t words);
+static size_t grow_size(size_t asize);
 static void *find_fit(size_t asize);
-static void place(void *bp, size_t asize);
+static void *place(void *bp, size_t asize);
+static void *top_alloc(size_t asize);
+static void realloc_place(void *bp, size_t size, size_t asize);
+static int arena_init(void);
+static void *arena_malloc(size_t size);
+static void arena_free(void *bp);
+static void *arena_realloc(void *ptr, size_t size);
+static void *arena_calloc(size_t nmemb, size_t size);
+static void *arena_memalign(size_t alignment, size_t size);
+static size_t usable_size(void *bp);
+static size_t arena_malloc_batch(size_t size, size_t n, void **out);
+static void arena_free_batch(void **ptrs, size_t n);
+static int ptr_cmp(const void *a, const void *b);
+static char *fastbin_pop(size_t asize);
+static void carve(void *bp, size_t asize, size_t n, void **out);
+static void chunk_free(void *bp);
+static void *map_malloc(size_t alignment, size_t size);
+static void map_free(void *bp);
+static void *map_realloc(void *bp, size_t size);
+static void free_block(void *bp);
+static void trim(void);
+static void consolidate(void);
+static void *slab_malloc(int cls);
+static void slab_free(void *ptr);
+static slab_run_t *slab_new_run(int cls);
 static void insert(void *bp); /* insert a free block to free list */
 static void delete(void *bp); /* delete a free block from free list */
+static void tree_insert(void *bp);
+static void tree_delete(void *bp);
+static void *tree_find(size_t asize);
+static void rotate_up(char *bp);
+#ifdef ADDR_ORDER
+static char *addr_insert(char *root, char *bp);
+static char *addr_delete(char *root, char *bp);
+static char *addr_merge(char *lo, char *hi);
+static char *addr_update(char *bp);
+static char *addr_first_fit(char *root, size_t asize);
+static char *addr_lowest(char *root);
+#endif
+#if HEAP_CHECK == 1
+static void check_size(void *bp, size_t size);
+#endif
 static void mm_checkheap(int verbose);
 
 /* 
- * mm_init - initialize the malloc package.
+ * arena_init - Create the initial empty heap of the current arena.
  */
-int mm_init(void)
+static int arena_init(void)
 {
     /* Create the initial empty heap */
-    if ((heap_listp = mem_sbrk(14*WSIZE)) == (void *) -1)
+    if ((arena->seglist_start = ARENA_SBRK(SEGLIST_SIZE + 3*WSIZE)) == (void *) -1)
         return -1;
-    
-    PUT(heap_listp, 0);                 /* Padding for alignment, user memory sits at 14*4 = 48 Bytes after heap start*/
-    PUT(heap_listp + (1*WSIZE), 0);     /* Block size <= 16   */
-    PUT(heap_listp + (2*WSIZE), 0);     /* Block size <= 32   */
-    PUT(heap_listp + (3*WSIZE), 0);     /* Block size <= 64   */
-    PUT(heap_listp + (4*WSIZE), 0);     /* Block size <= 128  */
-    PUT(heap_listp + (5*WSIZE), 0);     /* Block size <= 256  */
-    PUT(heap_listp + (6*WSIZE), 0);     /* Block size <= 512  */
-    PUT(heap_listp + (7*WSIZE), 0);     /* Block size <= 1024 */
-    PUT(heap_listp + (8*WSIZE), 0);     /* Block size <= 2048 */
-    PUT(heap_listp + (9*WSIZE), 0);     /* Block size <= 4096 */
-    PUT(heap_listp + (10*WSIZE), 0);    /* Block size >  4096 */
-    PUT(heap_listp + (11*WSIZE), PACK(DSIZE, 1));    /* Prologue header */
-    PUT(heap_listp + (12*WSIZE), PACK(DSIZE, 1));    /* Prologue footer */
-    PUT(heap_listp + (13*WSIZE), PACK(0, 1));        /* Epilogue header */
-
-    seglist_start = heap_listp + WSIZE;
-    DBG_PRINTF("seglist_start: %p\n", seglist_start);
-
-    /* Extend the empty heap with a free block of CHUNKSIZE bytes */
-    if (extend_heap(CHUNKSIZE/WSIZE) == NULL) /* set free list head to the first free block */
+    DBG_PRINTF("seglist_start: %p\n", arena->seglist_start);
+
+    /* All free lists are empty */
+    for (int i = 0; i < NUM_CLASSES; i++)
+        *SEGLIST_HEADP(i) = NULL;
+    arena->seglist_bitmap = 0;
+    arena->tree_root = NULL;
+    arena->top = NULL;
+    arena->grow_step = CHUNKSIZE;
+    memset(arena->fastbins, 0, sizeof(arena->fastbins));
+    arena->fastbin_bitmap = 0;
+    arena->fastbin_bytes = 0;
+    memset(arena->slab_partial, 0, sizeof(arena->slab_partial));
+    memset(arena->slab_pages, 0, sizeof(arena->slab_pages));
+
+    arena->heap_listp = arena->seglist_start + SEGLIST_SIZE;
+    PUT(arena->heap_listp, PACK(DSIZE, 3));                /* Prologue header */
+    PUT(arena->heap_listp + (1*WSIZE), PACK(DSIZE, 3));    /* Prologue footer */
+    PUT(arena->heap_listp + (2*WSIZE), PACK(0, 3));        /* Epilogue header */
+
+    /* Extend the empty heap with a top chunk of CHUNKSIZE bytes */
+    if (extend_heap(CHUNKSIZE/WSIZE) == NULL)
         return -1;
     return 0;
 }
 
 /* 
- * mm_malloc - Allocate a block by incrementing the brk pointer.
- *             Always allocate a block whose size is a multiple of the alignment.
+ * arena_malloc - Allocate a block by incrementing the brk pointer.
+ *                Always allocate a block whose size is a multiple of the alignment.
  */
-void *mm_malloc(size_t size)
+static void *arena_malloc(size_t size)
 {
-    DBG_PRINTF("Entering mm_malloc(%zu)\n", size);
+    DBG_PRINTF("Entering arena_malloc(%zu)\n", size);
     CHECKHEAP(0);
     size_t asize; /* Adjusted block size */
     size_t extendsize; /* Amount to extend heap if not fit */
@@ -247,260 +554,1400 @@ void *mm_malloc(size_t size)
         return NULL;
     }
 
-    /* Adjust block size to include overhead and alignment reqs */
-    if (size < DSIZE)
-        asize = 2 * DSIZE; /* Minimum block size: WORD(HDR) + DWORD(Payload) + WORD(FTR) */
-    else
-        asize = ALIGN(size + 8);
+    /* Small requests come from a slab run, huge ones from a mapping */
+    if (size <= SLAB_MAX)
+        return slab_malloc(SLAB_CLASS(size));
+    if (size >= MMAP_THRESHOLD)
+        return map_malloc(ALIGNMENT, size);
+
+    /* Adjust block size to include header and alignment reqs, it must be able to hold a free block */
+    asize = MAX(ALIGN(size + WSIZE), MINBLOCKSIZE);
 
-    /* Search the free list for a fit */
-    if ((bp = find_fit(asize)) != NULL) {
-        place(bp, asize);
+    /* A fastbin chunk of this size is still marked allocated, hand it out as it is */
+    if ((bp = fastbin_pop(asize)) != NULL)
         return bp;
+
+    /* Search the free list for a fit, merge the fastbin chunks into it if there is none */
+    if ((bp = find_fit(asize)) == NULL && arena->fastbin_bitmap) {
+        consolidate();
+        bp = find_fit(asize);
     }
+    if (bp != NULL)
+        return place(bp, asize);
 
-    /* No fit. Get more memory and place the block */
-    extendsize = MAX(asize, CHUNKSIZE);
-    if ((bp = extend_heap(extendsize / WSIZE)) == NULL)
+    /* No fit. Cut the block from the top chunk, grown first if it is too small */
+    if ((bp = top_alloc(asize)) != NULL)
+        return bp;
+    extendsize = grow_size(asize);
+    if (extend_heap(extendsize / WSIZE) == NULL)
         return NULL;
-    place(bp, asize);
-    return bp;
+    return top_alloc(asize);
 }
 
 /*
- * mm_free - Freeing a block and coalesce if necessary.
+ * arena_free - Freeing a block: small chunks go to their fastbin while the fastbins hold less than
+ *              FASTBIN_CONSOLIDATE bytes, unless they border the top chunk. Others are coalesced.
  */
-void mm_free(void *bp)
+static void arena_free(void *bp)
 {
-    DBG_PRINTF("Entering mm_free(%p)\n", bp);
+    DBG_PRINTF("Entering arena_free(%p)\n", bp);
     CHECKHEAP(0);
-    /* Modify header and footer then coalesce the block and insert it into free list */
-    PUT(HDRP(bp), PACK(GET_SIZE(HDRP(bp)),0));
-    PUT(FTRP(bp), PACK(GET_SIZE(HDRP(bp)),0));
-    coalesce(bp);
+
+    if (IS_SLAB(bp))
+        slab_free(bp);
+    else
+        chunk_free(bp);
 }
 
 /*
- * mm_realloc - Implemented simply in terms of mm_malloc and mm_free
+ * chunk_free - arena_free() for a block known to be a chunk.
  */
-void *mm_realloc(void *ptr, size_t size)
+static void chunk_free(void *bp)
 {
-    DBG_PRINTF("Entering mm_realloc(%p, %zu)\n", ptr, size);
-    CHECKHEAP(0);
-    void *oldptr = ptr;
+    size_t size = GET_SIZE(HDRP(bp));
+
+    if (size <= FASTBIN_MAX && arena->fastbin_bytes + size <= FASTBIN_CONSOLIDATE
+        && NEXT_BLKP(bp) != arena->top) {
+        PUT(HDRP(bp), GET(HDRP(bp)) & ~0x4); /* The next owner did not realloc it */
+        SET_FDP(bp, arena->fastbins[FASTBIN_INDEX(size)]);
+        arena->fastbins[FASTBIN_INDEX(size)] = bp;
+        arena->fastbin_bitmap |= 1ULL << FASTBIN_INDEX(size);
+        arena->fastbin_bytes += size;
+        return;
+    }
+    free_block(bp);
+}
+
+/*
+ * map_malloc - Give a block of size bytes, aligned to alignment (a power of two), a mapping of
+ *              its own. The payload starts alignment bytes or more into it, leaving room for
+ *              the offset and size words.
+ */
+static void *map_malloc(size_t alignment, size_t size)
+{
+    DBG_PRINTF("Entering map_malloc(%zu, %zu)\n", alignment, size);
+    size_t pagesize = mem_pagesize();
+    size_t align = MAX(alignment, ALIGNMENT);
+    size_t len;
+    char *start, *bp;
+
+    /* A mapping starts on a page boundary, only bigger alignments need room to move the payload */
+    len = size + align + (align > pagesize ? align : 0);
+    len = (len + pagesize - 1) & ~(pagesize - 1);
+    if (len < size || len > ~0x7U)
+        return NULL;
+    if ((start = mem_map(len)) == (void *)-1)
+        return NULL;
+
+    bp = (char *)(((uintptr_t)start + align) & ~(uintptr_t)(align - 1));
+    PUT(bp - DSIZE, bp - start);
+    PUT(HDRP(bp), PACK(len, 1));
+    return bp;
+}
+
+/*
+ * map_free - Give the mapping of block bp back whole.
+ */
+static void map_free(void *bp)
+{
+    DBG_PRINTF("Entering map_free(%p)\n", bp);
+    mem_unmap(MAP_START(bp));
+}
+
+/*
+ * map_realloc - Resize the mapped block bp: keep it while size fits, otherwise grow its mapping
+ *               with mem_remap() to size bytes and an eighth more, or move it to the heap below
+ *               MMAP_THRESHOLD. Blocks aligned to a page or more are moved to a new mapping,
+ *               mem_remap() may not keep their alignment.
+ */
+static void *map_realloc(void *bp, size_t size)
+{
+    DBG_PRINTF("Entering map_realloc(%p, %zu)\n", bp, size);
+    size_t avail = MAP_USABLE(bp);
+    size_t offset = MAP_OFFSET(bp), len;
+    char *start;
     void *newptr;
-    size_t copySize;
 
-    newptr = mm_malloc(size);
+    if (size == 0) {
+        map_free(bp);
+        return NULL;
+    }
+    if (size >= MMAP_THRESHOLD && size <= avail)
+        return bp;
+
+    /* Remapping keeps the payload at the same offset from the page it starts on. It copies no
+     * data, so the slack stays small */
+    if (size >= MMAP_THRESHOLD && offset < mem_pagesize()) {
+        len = offset + size + size / 8;
+        len = (len + mem_pagesize() - 1) & ~(mem_pagesize() - 1);
+        if (len < size || len > ~0x7U || (start = mem_remap(MAP_START(bp), len)) == (void *)-1)
+            return NULL;
+        bp = start + offset;
+        PUT(HDRP(bp), PACK(len, 1));
+        return bp;
+    }
+
+    if (size < MMAP_THRESHOLD)
+        newptr = mm_malloc(size);
+    else
+        newptr = map_malloc(ALIGNMENT, REALLOC_SLACK(size));
     if (newptr == NULL)
         return NULL;
-    size = GET_SIZE(HDRP(oldptr));
-    copySize = GET_SIZE(HDRP(newptr));
-    if (size < copySize)
-        copySize = size;
-    memcpy(newptr, oldptr, copySize-WSIZE);
-    mm_free(oldptr);
+    memcpy(newptr, bp, size < avail ? size : avail);
+    map_free(bp);
     return newptr;
 }
 
 /*
- * coalesce - Merge freed block if necessary.
- * Return: Pointer of the merged block.
+ * arena_realloc - Resize the block in place whenever its neighbours allow it:
+ *   1. Shrinking: split the tail off and free it, unless it is slack kept for a growing block.
+ *   2. Next block is free and big enough: absorb it.
+ *   3. Block (and a free next block) ends at the epilogue: extend the heap, then go on as in case 2.
+ *   4. Previous block is free and big enough (together with a free next block): merge and memmove the payload down.
+ * A chunk growing to MMAP_THRESHOLD bytes or more skips cases 2 to 4 and moves to a mapping of its own.
+ * Otherwise fall back to arena_malloc, memcpy and arena_free. Chunks shrinking to SLAB_MAX bytes or less
+ * always move to a slab object.
+ * A block growing for the second time or more aims at REALLOC_SLACK(asize) bytes instead of asize.
  */
-static void* coalesce(void* bp)
+static void *arena_realloc(void *ptr, size_t size)
 {
-    DBG_PRINTF("Entering coalesce(%p), ", bp);
+    DBG_PRINTF("Entering arena_realloc(%p, %zu)\n", ptr, size);
+    CHECKHEAP(0);
+    size_t asize; /* Adjusted block size */
+    size_t target; /* Block size to grow to, asize plus any slack */
+    size_t oldsize, newsize;
+    void *prev_bp, *next_bp, *newptr;
+    size_t prev_alloc, next_alloc, next_size;
 
-    /* 
-     * We have to save our adjacent block's address.
-     * After `PUT(HDRP(bp), PACK(newsize ,0))` will render NEXT_BLKP(bp) nonsense.
-     * It's really nasty and takes me a lot of time to debug.
-     */
-    void* prev_bp = PREV_BLKP(bp);
-    void* next_bp = NEXT_BLKP(bp);
+    if (ptr == NULL)
+        return arena_malloc(size);
+    if (size == 0) {
+        arena_free(ptr);
+        return NULL;
+    }
 
-    size_t prev_alloc = GET_ALLOC(FTRP(prev_bp));
-    size_t next_alloc = GET_ALLOC(HDRP(next_bp));
+    /* Slab object: keep it while the size stays in its class, otherwise move it */
+    if (IS_SLAB(ptr)) {
+        oldsize = SLAB_OBJSIZE(SLAB_RUN(ptr)->cls);
+        if (size <= oldsize && SLAB_CLASS(size) == SLAB_RUN(ptr)->cls)
+            return ptr;
+        if ((newptr = arena_malloc(size)) == NULL)
+            return NULL;
+        memcpy(newptr, ptr, size < oldsize ? size : oldsize);
+        slab_free(ptr);
+        return newptr;
+    }
 
-    size_t current_size = GET_SIZE(HDRP(bp));
+    /* Chunk shrunk to slab sizes: move it to a slab object, so that the request size alone
+     * tells slab objects from chunks (the thread caches and mm_free_sized() rely on it) */
+    if (size <= SLAB_MAX) {
+        if ((newptr = slab_malloc(SLAB_CLASS(size))) == NULL)
+            return NULL;
+        memcpy(newptr, ptr, size);
+        arena_free(ptr);
+        return newptr;
+    }
 
-    /* Case 0: no need to coalesce */
-    if (prev_alloc && next_alloc) {
-        DBG_PRINTF("no merge\n");
-        insert(bp); 
-        return bp; 
+    /* Adjust block size to include header and alignment reqs */
+    asize = MAX(ALIGN(size + WSIZE), MINBLOCKSIZE);
+
+    oldsize = GET_SIZE(HDRP(ptr));
+    next_bp = NEXT_BLKP(ptr);
+    next_alloc = GET_ALLOC(HDRP(next_bp));
+    next_size = next_alloc ? 0 : GET_SIZE(HDRP(next_bp));
+
+    /* Case 1: shrink in place, a grown block keeps its slack unless it shrinks to less than half */
+    if (asize <= oldsize) {
+        if (!GET_REALLOC(HDRP(ptr)) || asize < oldsize / 2)
+            realloc_place(ptr, oldsize, asize);
+        return ptr;
     }
-    /* 
-     * Case 1, previous block is free
-     */
-    else if (!prev_alloc && next_alloc) {
-        DBG_PRINTF("merge prev(%p)\n", prev_bp);
-        /* setup merged block */
-        current_size += GET_SIZE(HDRP(prev_bp));
-        delete(prev_bp);
-        PUT(HDRP(prev_bp), PACK(current_size, 0));
-        PUT(FTRP(bp), PACK(current_size, 0));
-        insert(prev_bp);
-        return prev_bp;
+    target = GET_REALLOC(HDRP(ptr)) ? REALLOC_SLACK(asize) : asize;
+
+    /* Big enough for a mapping: leave the heap instead of growing a big block in it */
+    if (size >= MMAP_THRESHOLD) {
+        if ((newptr = map_malloc(ALIGNMENT, REALLOC_SLACK(size))) == NULL)
+            return NULL;
+        memcpy(newptr, ptr, oldsize - WSIZE);
+        arena_free(ptr);
+        return newptr;
     }
-    /* 
-     * Case 2, next block is free, we need to delete next block from free list.
-     */
-    else if (prev_alloc && !next_alloc) {
-        DBG_PRINTF("merge next(%p)\n", next_bp);
-        current_size += GET_SIZE(HDRP(next_bp));
-        /* Delete next block from free list */
-        delete(next_bp);
-        /* setup merged block */
-        PUT(HDRP(bp), PACK(current_size, 0));
-        PUT(FTRP(bp), PACK(current_size, 0));
-        insert(bp);
-        return bp;
+
+    /* Case 3: we are the last block (but a free one) before the epilogue, grow the heap,
+     * grow_size() counts the free block in. The extension becomes the free next block. */
+    newsize = oldsize + next_size;
+    if (newsize < asize && GET_SIZE(HDRP(next_alloc ? next_bp : NEXT_BLKP(next_bp))) == 0) {
+        if (extend_heap(grow_size(asize - oldsize) / WSIZE) == NULL)
+            return NULL;
+        next_size = GET_SIZE(HDRP(next_bp));
+        newsize = oldsize + next_size;
     }
-    /* 
-     * Case 3, previous and next block both are free, we need to delete next block from free list.
-     */
-    else {
-        DBG_PRINTF("merge prev(%p) and next(%p)\n", prev_bp, next_bp);
-        current_size += GET_SIZE(HDRP(prev_bp));
-        current_size += GET_SIZE(FTRP(next_bp));
-        /* Delete prev and next block from free list */
-        delete(prev_bp);
+
+    /* Case 2: grow into the free next block, taking the slack too if it is there */
+    if (newsize >= asize) {
         delete(next_bp);
-        /* setup merged block */
-        PUT(HDRP(prev_bp), PACK(current_size, 0));
-        PUT(FTRP(next_bp), PACK(current_size, 0));
-        insert(prev_bp);
-        return prev_bp;
-    }   
+        realloc_place(ptr, newsize, newsize < target ? newsize : target);
+        SET_REALLOC(HDRP(ptr));
+        return ptr;
+    }
+
+    /* Case 4: merge backwards, the payload moves down to the previous block */
+    prev_alloc = GET_PREV_ALLOC(HDRP(ptr));
+    if (!prev_alloc) {
+        prev_bp = PREV_BLKP(ptr);
+        newsize += GET_SIZE(HDRP(prev_bp));
+        if (newsize >= asize) {
+            delete(prev_bp);
+            if (next_size)
+                delete(next_bp);
+            memmove(prev_bp, ptr, oldsize - WSIZE);
+            realloc_place(prev_bp, newsize, newsize < target ? newsize : target);
+            SET_REALLOC(HDRP(prev_bp));
+            return prev_bp;
+        }
+    }
+
+    /* No room around us, move the block */
+    newptr = arena_malloc(target - WSIZE);
+    if (newptr == NULL)
+        return NULL;
+    memcpy(newptr, ptr, oldsize - WSIZE);
+    if (!IS_MAPPED(newptr))
+        SET_REALLOC(HDRP(newptr));
+    arena_free(ptr);
+    return newptr;
 }
 
 /*
- * extend_heap - Extend the heap with a free block and coalesce the new free block if necessary.
- * Return : new free block's payload address.
+ * arena_calloc - Allocate a zeroed block for nmemb elements of size bytes. Memory from
+ *                ARENA_FRESH() on has never been handed out and reads as zero, so a block
+ *                reaching into it only needs the part below it cleared, along with the words
+ *                the heap extension wrote into it: the free block's links and its footer.
  */
-static void *extend_heap(size_t words)
+static void *arena_calloc(size_t nmemb, size_t size)
 {
+    DBG_PRINTF("Entering arena_calloc(%zu, %zu)\n", nmemb, size);
+    char *fresh = ARENA_FRESH();
     char *bp;
-    size_t size;
+    size_t dirty;
 
-    /* Allocate even number of words to maintain alignment */
-    size = (words % 2) ? (words + 1) * WSIZE : words * WSIZE;
-    if ((long)(bp = mem_sbrk(size)) == -1)
+    if (nmemb != 0 && size > SIZE_MAX / nmemb)
+        return NULL;
+    size *= nmemb;
+    if ((bp = arena_malloc(size)) == NULL)
         return NULL;
-    
-    /* Initialize free block header/footer and the epilogue header
-     * After mem_srbk(size), we are always at the end of epilogue footer, 
-     * so we need to change the epilogue ftr to normal header and setup epilogue footer at the end of heap.
-     */
-    PUT(HDRP(bp), PACK(size, 0));
-    PUT(FTRP(bp), PACK(size, 0));
-    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
 
-    /* Coalesce if the previous block was free */
-    return coalesce(bp);
+    /* A mapping is fresh */
+    if (IS_MAPPED(bp))
+        return bp;
+    if (IS_SLAB(bp) || bp + size <= fresh) {
+        memset(bp, 0, size);
+        return bp;
+    }
+    dirty = fresh - bp + 3*LSIZE;
+    memset(bp, 0, dirty < size ? dirty : size);
+    PUT(bp + GET_SIZE(HDRP(bp)) - DSIZE, 0);
+    return bp;
 }
 
-/* find_fit - Find freeblock that fits the request size and return it's bp */
-static void *find_fit(size_t asize)
+/*
+ * arena_memalign - Allocate a block whose payload is aligned to alignment, a power of two.
+ *                  Over-allocate, then give the gap in front of the aligned payload and the
+ *                  tail behind the requested size back as free blocks.
+ */
+static void *arena_memalign(size_t alignment, size_t size)
 {
-    DBG_PRINTF("Entering find_fit(%zu), ", asize);
-    /* Traverse all the free lists */
-    for ( int i = 0; i < 10; i++) {
-        DBG_PRINTF("LIST_OFFSET: %d\n", i);
-        freelist_headp = *(char **)(seglist_start + i * WSIZE);
-        /* Traverse free list */
-        for(void* current = freelist_headp; current != NULL; current = FDP(current)) {
-            if (GET_SIZE(HDRP(current)) >= asize) {
-                DBG_PRINTF("found %p, size: %u\n", current, GET_SIZE(HDRP(current)));
-                return current;
-            }
-        }
+    DBG_PRINTF("Entering arena_memalign(%zu, %zu)\n", alignment, size);
+    size_t asize, gap;
+    char *bp, *abp;
+
+    if (size == 0 || (alignment & (alignment - 1)))
+        return NULL;
+    if (alignment <= ALIGNMENT)
+        return arena_malloc(size);
+
+    /* Aligned blocks are chunks, keep them bigger than slab objects */
+    asize = MAX(ALIGN(MAX(size, SLAB_MAX + 1) + WSIZE), MINBLOCKSIZE);
+    if (asize + alignment + MINBLOCKSIZE >= MMAP_THRESHOLD)
+        return map_malloc(alignment, size);
+    if ((bp = arena_malloc(asize + alignment + MINBLOCKSIZE)) == NULL)
+        return NULL;
+
+    /* The gap in front of the aligned payload must be able to hold a free block */
+    abp = (char *)(((uintptr_t)bp + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    if (abp != bp && abp - bp < MINBLOCKSIZE)
+        abp += alignment;
+    if (abp != bp) {
+        gap = abp - bp;
+        PUT(HDRP(abp), PACK(GET_SIZE(HDRP(bp)) - gap, 1));
+        PUT(HDRP(bp), PACK(gap, GET_PREV_ALLOC(HDRP(bp))));
+        PUT(FTRP(bp), PACK(gap, GET_PREV_ALLOC(HDRP(bp))));
+        coalesce(bp);
     }
-    /* Not found */
-    DBG_PRINTF("not found\n");
-    return NULL;
+    realloc_place(abp, GET_SIZE(HDRP(abp)), asize);
+    return abp;
 }
 
-/* place - Place requested block in current free block, split if necessary */
-static void place(void *bp, size_t asize)
+/*
+ * usable_size - Bytes of block bp the caller may use: the object size of a slab object,
+ *               everything up to the next header for a chunk.
+ */
+static size_t usable_size(void *bp)
 {
-    DBG_PRINTF("Entering place(%p)",bp);
+    if (bp == NULL)
+        return 0;
+    if (IS_SLAB(bp))
+        return SLAB_OBJSIZE(SLAB_RUN(bp)->cls);
+    return GET_SIZE(HDRP(bp)) - WSIZE;
+}
 
-    delete(bp);
+/*
+ * arena_malloc_batch - Allocate n blocks for size bytes each into out: fastbin chunks of the
+ *                      size first, then the rest carved side by side from one free block per
+ *                      BATCH_MAX bytes, with one free list update for all of them.
+ * Return: the number of blocks allocated, less than n if the heap is full.
+ */
+static size_t arena_malloc_batch(size_t size, size_t n, void **out)
+{
+    DBG_PRINTF("Entering arena_malloc_batch(%zu, %zu)\n", size, n);
+    CHECKHEAP(0);
+    size_t asize, k, done = 0;
+    char *bp;
 
-    size_t size = GET_SIZE(HDRP(bp));
-    
-    if ((size - asize) >= MINBLOCKSIZE)
-    {
-        /* set up current block */
-        PUT(HDRP(bp), PACK(asize, 1));
-        PUT(FTRP(bp), PACK(asize, 1));
-        DBG_PRINTF("split: %p and %p\n", bp, NEXT_BLKP(bp));
+    if (size == 0)
+        return 0;
 
-         /* set up remain block */
-        PUT(HDRP(NEXT_BLKP(bp)), PACK(size-asize, 0));
-        PUT(FTRP(NEXT_BLKP(bp)), PACK(size-asize, 0));
-        coalesce(NEXT_BLKP(bp));
+    /* Slab objects have no free block to share, they come one by one */
+    if (size <= SLAB_MAX) {
+        for (; done < n; done++)
+            if ((out[done] = slab_malloc(SLAB_CLASS(size))) == NULL)
+                break;
+        return done;
     }
-    else {
-        DBG_PRINTF("no split\n");
-        /* Waste some space, we have no other way */
-        PUT(HDRP(bp), PACK(size, 1));
-        PUT(FTRP(bp), PACK(size, 1));
+
+    /* Neither do mapped blocks */
+    if (size >= MMAP_THRESHOLD) {
+        for (; done < n; done++)
+            if ((out[done] = map_malloc(ALIGNMENT, size)) == NULL)
+                break;
+        return done;
     }
 
+    asize = MAX(ALIGN(size + WSIZE), MINBLOCKSIZE);
+    for (; done < n && (bp = fastbin_pop(asize)) != NULL; done++)
+        out[done] = bp;
+
+    while (done < n) {
+        k = n - done;
+        if (k * asize > BATCH_MAX)
+            k = MAX(BATCH_MAX / asize, 1);
+        if ((bp = find_fit(k * asize)) == NULL && arena->fastbin_bitmap) {
+            consolidate();
+            bp = find_fit(k * asize);
+        }
+        if (bp == NULL && arena->top != NULL && GET_SIZE(HDRP(arena->top)) >= k * asize)
+            bp = arena->top;
+        if (bp == NULL)
+            break;
+        carve(bp, asize, k, out + done);
+        done += k;
+    }
+
+    /* No free block holds the rest: fill the smaller holes one by one before the heap grows */
+    for (; done < n; done++)
+        if ((out[done] = arena_malloc(size)) == NULL)
+            break;
+    return done;
 }
 
 /*
- * insert - Insert given block pointer to the head of free list.
- * insert() is called by free() or place()
+ * arena_free_batch - Free the n blocks of ptrs, sorted by address. Chunks lying side by side
+ *                    are merged into one block first, so each run is coalesced only once.
  */
-static void insert(void* bp)
+static void arena_free_batch(void **ptrs, size_t n)
 {
-    DBG_PRINTF("Entering insert(%p)\n", bp);
+    DBG_PRINTF("Entering arena_free_batch(%zu)\n", n);
+    size_t i, j, size;
+    char *bp;
 
-    /* Locate freelist */
-    char **ptr_to_freelist_headp = (char **)(seglist_start + LIST_OFFSET(GET_SIZE(HDRP(bp))) * WSIZE);
-    DBG_PRINTF("LIST_OFFSET: %d\n", LIST_OFFSET(GET_SIZE(HDRP(bp))));
-    freelist_headp = *ptr_to_freelist_headp;
+    for (i = 0; i < n; i = j) {
+        bp = ptrs[i];
+        j = i + 1;
+        if (IS_SLAB(bp)) {
+            slab_free(bp);
+            continue;
+        }
 
-    /* List is NULL, make bp as list head */
-    if (freelist_headp == NULL) {
-        DBG_PRINTF("Free list is NULL, make %p the head of free list\n", bp);
-        SET_FDP(bp, NULL);
-        SET_BKP(bp, NULL);
-    }
-    /* insert */
-    else {
-        DBG_PRINTF("Free list not null,  %p will be new head\n", bp);
-        /* Set up current block */
-        SET_FDP(bp, freelist_headp);
-        SET_BKP(bp, 0);
-        /* Set up next block */
-        SET_BKP(freelist_headp, bp);
+        /* A slab object never starts where a chunk ends, the next chunk's payload is a run header */
+        size = GET_SIZE(HDRP(bp));
+        while (j < n && (char *)ptrs[j] == bp + size)
+            size += GET_SIZE(HDRP(ptrs[j++]));
+        if (j == i + 1) {
+            arena_free(bp);
+            continue;
+        }
+        PUT(HDRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp)) | 1));
+        free_block(bp);
     }
-
-    /* Free list head is np now */
-    *ptr_to_freelist_headp = bp;
-    return;
 }
+
 /*
- * delete - Remove given block pointer from free list.
- * delete() is called by place() or coalesce();
- * we dont' call delete() when there's no free block, so what we deleted is what we inserted.
+ * ptr_cmp - Order pointers by address, for qsort().
  */
-static void delete(void* bp)
+static int ptr_cmp(const void *a, const void *b)
 {
-    DBG_PRINTF("Entering delete(%p)\n", bp);
+    char *p = *(char * const *)a, *q = *(char * const *)b;
+
+    return (p > q) - (p < q);
+}
+
+#ifndef THREADED
+/* 
+ * mm_init - initialize the malloc package.
+ */
+int mm_init(void)
+{
+    return arena_init();
+}
+
+void *mm_malloc(size_t size)
+{
+    return arena_malloc(size);
+}
+
+void mm_free(void *bp)
+{
+    if (bp == NULL)
+        return;
+    if (IS_MAPPED(bp))
+        map_free(bp);
+    else
+        arena_free(bp);
+}
+
+void *mm_realloc(void *ptr, size_t size)
+{
+    if (ptr != NULL && IS_MAPPED(ptr))
+        return map_realloc(ptr, size);
+    return arena_realloc(ptr, size);
+}
+
+void *mm_calloc(size_t nmemb, size_t size)
+{
+    return arena_calloc(nmemb, size);
+}
+
+void *mm_memalign(size_t alignment, size_t size)
+{
+    return arena_memalign(alignment, size);
+}
+
+size_t mm_usable_size(void *ptr)
+{
+    if (ptr != NULL && IS_MAPPED(ptr))
+        return MAP_USABLE(ptr);
+    return usable_size(ptr);
+}
+
+size_t mm_malloc_batch(size_t size, size_t n, void **out)
+{
+    return arena_malloc_batch(size, n, out);
+}
+
+/*
+ * mm_free_batch - Free the n blocks of ptrs, ptrs is sorted by address on return. Sorted, the
+ *                 mapped blocks come before or after the heap blocks.
+ */
+void mm_free_batch(void **ptrs, size_t n)
+{
+    size_t i, j;
+
+    qsort(ptrs, n, sizeof(*ptrs), ptr_cmp);
+    for (i = 0; i < n && IS_MAPPED(ptrs[i]); i++)
+        map_free(ptrs[i]);
+    for (j = n; j > i && IS_MAPPED(ptrs[j - 1]); j--)
+        map_free(ptrs[j - 1]);
+    arena_free_batch(ptrs + i, j - i);
+}
+
+/*
+ * mm_free_sized - Free a block of size bytes: the size tells a slab object from a chunk.
+ */
+void mm_free_sized(void *bp, size_t size)
+{
+    if (bp == NULL)
+        return;
+    if (IS_MAPPED(bp)) {
+        map_free(bp);
+        return;
+    }
+    CHECKSIZE(bp, size);
+    if (size <= SLAB_MAX && IS_SLAB(bp))
+        slab_free(bp);
+    else
+        chunk_free(bp);
+}
+#else
+/*
+ * owner - Arena whose region holds bp.
+ */
+static arena_t *owner(void *bp)
+{
+    for (int i = 0; i < NUM_ARENAS; i++)
+        if ((char *)bp >= arenas[i].region_lo && (char *)bp < arenas[i].region_lo + MAX_HEAP)
+            return &arenas[i];
+    return NULL;
+}
+
+/*
+ * lock_arena - Make a the current arena and lock it, creating its heap on first use.
+ */
+static int lock_arena(arena_t *a)
+{
+    arena = a;
+    pthread_mutex_lock(&a->lock);
+    if (a->heap_listp == NULL && arena_init() < 0) {
+        pthread_mutex_unlock(&a->lock);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * thread_cache - The calling thread's cache, emptied and given a home arena after mm_init().
+ */
+static tcache_t *thread_cache(void)
+{
+    if (tcache.epoch != epoch) {
+        memset(&tcache, 0, sizeof(tcache));
+        tcache.epoch = epoch;
+        tcache.home = &arenas[__sync_fetch_and_add(&next_arena, 1) % NUM_ARENAS];
+    }
+    return &tcache;
+}
+
+/* 
+ * mm_init - initialize the malloc package. Must not run concurrently with other calls.
+ */
+int mm_init(void)
+{
+    static int locks_ready;
+
+    for (int i = 0; i < NUM_ARENAS; i++) {
+        if (!locks_ready)
+            pthread_mutex_init(&arenas[i].lock, NULL);
+        /* Map every region now, so that owner() never races with a region's creation */
+        if (mem_region_sbrk(i, 0) == (void *)-1)
+            return -1;
+        arenas[i].region_lo = mem_region_lo(i);
+        arenas[i].heap_listp = NULL;
+    }
+    locks_ready = 1;
+    next_arena = 0;
+    epoch++;
+
+    /* Arena 0 always exists, the others are created by their first thread */
+    arena = &arenas[0];
+    return arena_init();
+}
+
+/*
+ * mm_malloc - Pop a cached block of the right size, or allocate from the thread's arena.
+ */
+void *mm_malloc(size_t size)
+{
+    tcache_t *tc = thread_cache();
+    void *bp;
+    int bin;
+
+    if (size == 0)
+        return NULL;
+    if (size >= MMAP_THRESHOLD)
+        return map_malloc(ALIGNMENT, size);
+    bin = size <= SLAB_MAX ? TCACHE_SLAB_BIN(SLAB_CLASS(size))
+                           : TCACHE_BLOCK_BIN(MAX(ALIGN(size + WSIZE), MINBLOCKSIZE));
+    if (bin >= 0 && (bp = tc->head[bin]) != NULL) {
+        tc->head[bin] = *(void **)bp;
+        tc->count[bin]--;
+        return bp;
+    }
+
+    if (lock_arena(tc->home) < 0)
+        return NULL;
+    bp = arena_malloc(size);
+    pthread_mutex_unlock(&tc->home->lock);
+    return bp;
+}
+
+/*
+ * mm_free - Keep the block in the thread's cache if its list has room, otherwise free it in its arena.
+ *           Mapped blocks belong to no arena, they are unmapped right away.
+ */
+void mm_free(void *bp)
+{
+    tcache_t *tc = thread_cache();
+    arena_t *a;
+    int bin;
+
+    if (bp == NULL)
+        return;
+    if ((a = owner(bp)) == NULL) {
+        map_free(bp);
+        return;
+    }
+
+    /* The size bits of a live block do not change, so they are safe to read without the lock */
+    arena = a;
+    bin = IS_SLAB(bp) ? TCACHE_SLAB_BIN(SLAB_RUN(bp)->cls) : TCACHE_BLOCK_BIN(GET_SIZE(HDRP(bp)));
+    if (bin >= 0 && tc->count[bin] < TCACHE_COUNT) {
+        *(void **)bp = tc->head[bin];
+        tc->head[bin] = bp;
+        tc->count[bin]++;
+        return;
+    }
+
+    lock_arena(a);
+    arena_free(bp);
+    pthread_mutex_unlock(&a->lock);
+}
+
+/*
+ * mm_free_sized - mm_free() with the cache list picked from the size, no page map lookup.
+ */
+void mm_free_sized(void *bp, size_t size)
+{
+    tcache_t *tc = thread_cache();
+    arena_t *a;
+    int bin, slab;
+
+    if (bp == NULL)
+        return;
+    if ((a = owner(bp)) == NULL) {
+        map_free(bp);
+        return;
+    }
+    arena = a;
+    CHECKSIZE(bp, size);
+    slab = size <= SLAB_MAX && IS_SLAB(bp);
+    bin = slab ? TCACHE_SLAB_BIN(SLAB_CLASS(size)) : TCACHE_BLOCK_BIN(GET_SIZE(HDRP(bp)));
+    if (bin >= 0 && tc->count[bin] < TCACHE_COUNT) {
+        *(void **)bp = tc->head[bin];
+        tc->head[bin] = bp;
+        tc->count[bin]++;
+        return;
+    }
+
+    lock_arena(a);
+    if (slab)
+        slab_free(bp);
+    else
+        chunk_free(bp);
+    pthread_mutex_unlock(&a->lock);
+}
+
+/*
+ * mm_realloc - Resize the block in the arena that owns it, mapped blocks need no lock.
+ */
+void *mm_realloc(void *ptr, size_t size)
+{
+    arena_t *a;
+
+    if (ptr == NULL)
+        return mm_malloc(size);
+    if (size == 0) {
+        mm_free(ptr);
+        return NULL;
+    }
+
+    if ((a = owner(ptr)) == NULL)
+        return map_realloc(ptr, size);
+    lock_arena(a);
+    ptr = arena_realloc(ptr, size);
+    pthread_mutex_unlock(&a->lock);
+    return ptr;
+}
+
+/*
+ * mm_calloc - Allocate zeroed memory from the thread's arena, cached blocks are not known to be zero.
+ */
+void *mm_calloc(size_t nmemb, size_t size)
+{
+    tcache_t *tc = thread_cache();
+    void *bp;
+
+    if (lock_arena(tc->home) < 0)
+        return NULL;
+    bp = arena_calloc(nmemb, size);
+    pthread_mutex_unlock(&tc->home->lock);
+    return bp;
+}
+
+/*
+ * mm_memalign - Allocate an aligned block from the thread's arena.
+ */
+void *mm_memalign(size_t alignment, size_t size)
+{
+    tcache_t *tc = thread_cache();
+    void *bp;
+
+    if (lock_arena(tc->home) < 0)
+        return NULL;
+    bp = arena_memalign(alignment, size);
+    pthread_mutex_unlock(&tc->home->lock);
+    return bp;
+}
+
+/*
+ * mm_usable_size - The size bits of a live block do not change, no lock needed.
+ */
+size_t mm_usable_size(void *ptr)
+{
+    if (ptr == NULL)
+        return 0;
+    if ((arena = owner(ptr)) == NULL)
+        return MAP_USABLE(ptr);
+    return usable_size(ptr);
+}
+
+/*
+ * mm_malloc_batch - Allocate n blocks from the thread's arena under one lock, bypassing the cache.
+ */
+size_t mm_malloc_batch(size_t size, size_t n, void **out)
+{
+    tcache_t *tc = thread_cache();
+    size_t done;
+
+    if (lock_arena(tc->home) < 0)
+        return 0;
+    done = arena_malloc_batch(size, n, out);
+    pthread_mutex_unlock(&tc->home->lock);
+    return done;
+}
+
+/*
+ * mm_free_batch - Free the n blocks of ptrs, locking each arena once: sorted by address,
+ *                 the blocks of an arena are next to each other. ptrs is sorted on return.
+ */
+void mm_free_batch(void **ptrs, size_t n)
+{
+    arena_t *a;
+    size_t i, j;
+
+    qsort(ptrs, n, sizeof(*ptrs), ptr_cmp);
+    for (i = 0; i < n; i = j) {
+        a = owner(ptrs[i]);
+        for (j = i + 1; j < n && owner(ptrs[j]) == a; j++)
+            ;
+        if (a == NULL) {
+            while (i < j)
+                map_free(ptrs[i++]);
+            continue;
+        }
+        lock_arena(a);
+        arena_free_batch(ptrs + i, j - i);
+        pthread_mutex_unlock(&a->lock);
+    }
+}
+#endif
+
+/*
+ * mm_posix_memalign - mm_memalign() with the POSIX interface: alignment must be a power
+ *                     of two multiple of sizeof(void *), errors are returned, not set in errno.
+ */
+int mm_posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *bp;
+
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)))
+        return EINVAL;
+    if (size == 0) {
+        *memptr = NULL;
+        return 0;
+    }
+    if ((bp = mm_memalign(alignment, size)) == NULL)
+        return ENOMEM;
+    *memptr = bp;
+    return 0;
+}
+
+/*
+ * coalesce - Merge freed block if necessary.
+ * Return: Pointer of the merged block.
+ */
+static void* coalesce(void* bp)
+{
+    DBG_PRINTF("Entering coalesce(%p), ", bp);
+
+    /* 
+     * We have to save our adjacent block's address.
+     * After `PUT(HDRP(bp), PACK(newsize ,0))` will render NEXT_BLKP(bp) nonsense.
+     * It's really nasty and takes me a lot of time to debug.
+     */
+    void* prev_bp;
+    void* next_bp = NEXT_BLKP(bp);
+
+    size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp)); /* Previous block has no footer if allocated */
+    size_t next_alloc = GET_ALLOC(HDRP(next_bp));
+
+    size_t current_size = GET_SIZE(HDRP(bp));
+
+    /* Next block's previous block is free now */
+    CLR_PREV_ALLOC(HDRP(next_bp));
+
+    /* Case 0: no need to coalesce */
+    if (prev_alloc && next_alloc) {
+        DBG_PRINTF("no merge\n");
+        insert(bp); 
+        return bp; 
+    }
+    /* 
+     * Case 1, previous block is free
+     */
+    else if (!prev_alloc && next_alloc) {
+        prev_bp = PREV_BLKP(bp);
+        DBG_PRINTF("merge prev(%p)\n", prev_bp);
+        /* setup merged block */
+        current_size += GET_SIZE(HDRP(prev_bp));
+        delete(prev_bp);
+        PUT(HDRP(prev_bp), PACK(current_size, 2));
+        PUT(FTRP(bp), PACK(current_size, 2));
+        insert(prev_bp);
+        return prev_bp;
+    }
+    /* 
+     * Case 2, next block is free, we need to delete next block from free list.
+     */
+    else if (prev_alloc && !next_alloc) {
+        DBG_PRINTF("merge next(%p)\n", next_bp);
+        current_size += GET_SIZE(HDRP(next_bp));
+        /* Delete next block from free list */
+        delete(next_bp);
+        /* setup merged block */
+        PUT(HDRP(bp), PACK(current_size, 2));
+        PUT(FTRP(bp), PACK(current_size, 2));
+        insert(bp);
+        return bp;
+    }
+    /* 
+     * Case 3, previous and next block both are free, we need to delete next block from free list.
+     */
+    else {
+        prev_bp = PREV_BLKP(bp);
+        DBG_PRINTF("merge prev(%p) and next(%p)\n", prev_bp, next_bp);
+        current_size += GET_SIZE(HDRP(prev_bp));
+        current_size += GET_SIZE(FTRP(next_bp));
+        /* Delete prev and next block from free list */
+        delete(prev_bp);
+        delete(next_bp);
+        /* setup merged block */
+        PUT(HDRP(prev_bp), PACK(current_size, 2));
+        PUT(FTRP(next_bp), PACK(current_size, 2));
+        insert(prev_bp);
+        return prev_bp;
+    }   
+}
+
+/*
+ * extend_heap - Extend the heap, growing the top chunk in place, or making the new memory the
+ *               top chunk if the last block is allocated.
+ * Return : the top chunk's payload address.
+ */
+static void *extend_heap(size_t words)
+{
+    char *bp;
+    size_t size;
+
+    /* Allocate a multiple of ALIGNMENT bytes to maintain alignment */
+    size = ALIGN(words * WSIZE);
+    if ((long)(bp = ARENA_SBRK(size)) == -1)
+        return NULL;
+
+    /* After mem_sbrk(size) bp is right behind the epilogue header, which becomes the new block's header */
+    if (arena->top != NULL) {
+        bp = arena->top;
+        size += GET_SIZE(HDRP(bp));
+    }
+    PUT(HDRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp))));
+    PUT(FTRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp))));
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* New epilogue header */
+    arena->top = bp;
+    return bp;
+}
+
+/*
+ * grow_size - Bytes to extend the heap by for a block of asize bytes. The top chunk counts
+ *             towards asize. Each extension doubles the step for the next
+ *             one, so a ramp of allocations needs O(log n) extensions, but the step stays below
+ *             1/GROW_GUARD of the heap so a burst does not overshoot by much. trim() resets it.
+ */
+static size_t grow_size(size_t asize)
+{
+    char *epilogue = (char *)ARENA_HEAP_HI() + 1 - WSIZE;
+    size_t heapsize = epilogue + WSIZE - arena->seglist_start;
+    size_t need = asize, step = arena->grow_step;
+
+    /* The extension grows the top chunk */
+    if (arena->top != NULL)
+        need -= GET_SIZE(HDRP(arena->top));
+
+    arena->grow_step = MAX(CHUNKSIZE, step * 2 < heapsize / GROW_GUARD ? step * 2 : heapsize / GROW_GUARD);
+    DBG_PRINTF("grow_size(%zu): need %zu, step %zu\n", asize, need, step);
+    return ALIGN(MAX(need, step));
+}
+
+/* find_fit - Find freeblock that fits the request size and return it's bp */
+static void *find_fit(size_t asize)
+{
+    DBG_PRINTF("Entering find_fit(%zu), ", asize);
+    int i;
+    unsigned long long bigger;
+
+    /* Large requests: best fit in the tree */
+    if (asize >= TREE_MIN)
+        return tree_find(asize);
+
+    /* Only asize's own class may hold blocks smaller than asize, traverse it */
+    i = LIST_OFFSET(asize);
+    if (arena->seglist_bitmap & (1ULL << i)) {
+        arena->freelist_headp = *SEGLIST_HEADP(i);
+#ifdef ADDR_ORDER
+        void *current = addr_first_fit(arena->freelist_headp, asize);
+        if (current != NULL)
+            return current;
+#else
+        void *best = NULL;
+        int fits = 0;
+
+        /* Good fit: stop at an exact fit or after GOOD_FIT_K fits, keep the tightest */
+        for(void* current = arena->freelist_headp, *next; current != NULL; current = next) {
+            next = FDP(current);
+#if PREFETCH == 1
+            __builtin_prefetch(HDRP(next));
+#endif
+            if (GET_SIZE(HDRP(current)) >= asize) {
+                if (best == NULL || GET_SIZE(HDRP(current)) < GET_SIZE(HDRP(best)))
+                    best = current;
+                if (GET_SIZE(HDRP(current)) == asize || ++fits == GOOD_FIT_K)
+                    break;
+            }
+        }
+        if (best != NULL) {
+            DBG_PRINTF("found %p, size: %u\n", best, GET_SIZE(HDRP(best)));
+            return best;
+        }
+#endif
+    }
+
+    /* In any bigger class the first block fits, jump to the first non-empty one */
+    bigger = arena->seglist_bitmap & (~0ULL << (i + 1));
+    if (bigger) {
+        i = __builtin_ctzll(bigger);
+        DBG_PRINTF("LIST_OFFSET: %d, found %p\n", i, *SEGLIST_HEADP(i));
+#ifdef ADDR_ORDER
+        return addr_lowest(*SEGLIST_HEADP(i));
+#else
+        return *SEGLIST_HEADP(i);
+#endif
+    }
+
+    /* Every tree node fits, take the smallest */
+    return tree_find(asize);
+}
+
+/*
+ * place - Place requested block in current free block, split if necessary. Blocks of PLACE_HIGH_MIN
+ *         bytes or more take the high end of the free block, smaller ones the low end.
+ * Return: the allocated block.
+ */
+static void *place(void *bp, size_t asize)
+{
+    DBG_PRINTF("Entering place(%p)",bp);
+
+    delete(bp);
+
+    size_t size = GET_SIZE(HDRP(bp));
+
+    if ((size - asize) >= MINBLOCKSIZE && asize >= PLACE_HIGH_MIN)
+    {
+        DBG_PRINTF("split high: %p and %p\n", bp, (char *)bp + size - asize);
+        /* The low end stays free, its neighbours are allocated: no coalescing */
+        PUT(HDRP(bp), PACK(size-asize, 2));
+        PUT(FTRP(bp), PACK(size-asize, 2));
+        PUT(HDRP(NEXT_BLKP(bp)), PACK(asize, 1));
+        SET_PREV_ALLOC(HDRP(NEXT_BLKP(NEXT_BLKP(bp))));
+        insert(bp);
+        bp = NEXT_BLKP(bp);
+    }
+    else if ((size - asize) >= MINBLOCKSIZE)
+    {
+        /* set up current block, previous block of a free block is always allocated */
+        PUT(HDRP(bp), PACK(asize, 3));
+        DBG_PRINTF("split: %p and %p\n", bp, NEXT_BLKP(bp));
+
+         /* set up remain block */
+        PUT(HDRP(NEXT_BLKP(bp)), PACK(size-asize, 2));
+        PUT(FTRP(NEXT_BLKP(bp)), PACK(size-asize, 2));
+        coalesce(NEXT_BLKP(bp));
+    }
+    else {
+        DBG_PRINTF("no split\n");
+        /* Waste some space, we have no other way */
+        PUT(HDRP(bp), PACK(size, 3));
+        SET_PREV_ALLOC(HDRP(NEXT_BLKP(bp)));
+    }
+    return bp;
+}
+
+/*
+ * top_alloc - Cut an allocated block of asize bytes from the front of the top chunk, the rest
+ *             stays the top chunk. No list is touched.
+ * Return: the block, NULL if the top chunk is missing or too small.
+ */
+static void *top_alloc(size_t asize)
+{
+    char *bp = arena->top;
+    size_t size;
+
+    if (bp == NULL || (size = GET_SIZE(HDRP(bp))) < asize)
+        return NULL;
+    DBG_PRINTF("Entering top_alloc(%zu), top: %p\n", asize, bp);
+
+    /* Previous block of a free block is always allocated */
+    if (size - asize >= MINBLOCKSIZE) {
+        PUT(HDRP(bp), PACK(asize, 3));
+        arena->top = NEXT_BLKP(bp);
+        PUT(HDRP(arena->top), PACK(size - asize, 2));
+        PUT(FTRP(arena->top), PACK(size - asize, 2));
+    }
+    else {
+        PUT(HDRP(bp), PACK(size, 3));
+        SET_PREV_ALLOC(HDRP(NEXT_BLKP(bp)));
+        arena->top = NULL;
+    }
+    return bp;
+}
+
+/*
+ * carve - Cut n allocated blocks of asize bytes, side by side, from the front of free block bp
+ *         into out. The tail is freed, or added to the last block if too small to be free.
+ */
+static void carve(void *bp, size_t asize, size_t n, void **out)
+{
+    DBG_PRINTF("Entering carve(%p, %zu, %zu)\n", bp, asize, n);
+    size_t rest;
+    char *cur = bp;
+
+    delete(bp);
+    rest = GET_SIZE(HDRP(bp)) - n * asize;
+
+    /* Previous block of a free block is always allocated, and so is that of each carved block */
+    for (size_t i = 0; i < n; i++) {
+        out[i] = cur;
+        PUT(HDRP(cur), PACK(asize, 3));
+        cur += asize;
+    }
+
+    if (rest >= MINBLOCKSIZE) {
+        PUT(HDRP(cur), PACK(rest, 2));
+        PUT(FTRP(cur), PACK(rest, 2));
+        coalesce(cur);
+    }
+    else {
+        PUT(HDRP(out[n - 1]), PACK(asize + rest, 3));
+        SET_PREV_ALLOC(HDRP(cur + rest));
+    }
+}
+
+/*
+ * realloc_place - Make the (already unlinked) block bp of size bytes an allocated block of asize bytes,
+ *                 split the tail off and free it if it is big enough.
+ */
+static void realloc_place(void *bp, size_t size, size_t asize)
+{
+    DBG_PRINTF("Entering realloc_place(%p, %zu, %zu)\n", bp, size, asize);
+    size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp));
+
+    if ((size - asize) >= MINBLOCKSIZE) {
+        PUT(HDRP(bp), PACK(asize, prev_alloc | 1));
+        /* The tail may border a free block, so coalesce it */
+        PUT(HDRP(NEXT_BLKP(bp)), PACK(size-asize, 2));
+        PUT(FTRP(NEXT_BLKP(bp)), PACK(size-asize, 2));
+        coalesce(NEXT_BLKP(bp));
+    }
+    else {
+        PUT(HDRP(bp), PACK(size, prev_alloc | 1));
+        SET_PREV_ALLOC(HDRP(NEXT_BLKP(bp)));
+    }
+}
+
+/*
+ * free_block - Mark block bp free, coalesce it and insert it into free list.
+ */
+static void free_block(void *bp)
+{
+    /* Modify header and footer then coalesce the block and insert it into free list */
+    size_t size = GET_SIZE(HDRP(bp));
+    PUT(HDRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp))));
+    PUT(FTRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp))));
+    bp = coalesce(bp);
+
+    /* A big chunk or the top chunk: flush the fastbins too, then look at the (maybe grown) top chunk */
+    if ((GET_SIZE(HDRP(bp)) >= FASTBIN_CONSOLIDATE || bp == arena->top) && arena->fastbin_bitmap)
+        consolidate();
+    trim();
+}
+
+/*
+ * fastbin_pop - Take a chunk of asize bytes from its fastbin, NULL if there is none.
+ */
+static char *fastbin_pop(size_t asize)
+{
+    char *bp;
+
+    if (asize > FASTBIN_MAX || (bp = arena->fastbins[FASTBIN_INDEX(asize)]) == NULL)
+        return NULL;
+    if ((arena->fastbins[FASTBIN_INDEX(asize)] = FDP(bp)) == NULL)
+        arena->fastbin_bitmap &= ~(1ULL << FASTBIN_INDEX(asize));
+    arena->fastbin_bytes -= asize;
+    return bp;
+}
+
+/*
+ * consolidate - Empty the fastbins, freeing and coalescing every chunk in them.
+ */
+static void consolidate(void)
+{
+    DBG_PRINTF("Entering consolidate()\n");
+    unsigned long long bins = arena->fastbin_bitmap;
+    char *bp, *next;
+    size_t size;
+    int i;
+
+    while (bins) {
+        i = __builtin_ctzll(bins);
+        bins &= bins - 1;
+        for (bp = arena->fastbins[i]; bp != NULL; bp = next) {
+            next = FDP(bp);
+            size = GET_SIZE(HDRP(bp));
+            PUT(HDRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp))));
+            PUT(FTRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp))));
+            coalesce(bp);
+        }
+        arena->fastbins[i] = NULL;
+    }
+    arena->fastbin_bitmap = 0;
+    arena->fastbin_bytes = 0;
+}
+
+/*
+ * trim - Give the tail of the top chunk back to memlib once it has reached
+ *        TRIM_THRESHOLD bytes, keeping TRIM_PAD bytes of it.
+ */
+static void trim(void)
+{
+    char *bp = arena->top;
+    size_t size;
+
+    if (bp == NULL || (size = GET_SIZE(HDRP(bp))) < TRIM_THRESHOLD || size <= TRIM_PAD)
+        return;
+    DBG_PRINTF("Entering trim(%p), size: %zu\n", bp, size);
+
+    if (ARENA_SBRK(-(int)(size - TRIM_PAD)) == (void *)-1)
+        return;
+    PUT(HDRP(bp), PACK(TRIM_PAD, 2));
+    PUT(FTRP(bp), PACK(TRIM_PAD, 2));
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* New epilogue header */
+    arena->grow_step = CHUNKSIZE;
+}
+
+/*
+ * slab_malloc - Take the first free object of the first run with free objects in slab class cls.
+ */
+static void *slab_malloc(int cls)
+{
+    DBG_PRINTF("Entering slab_malloc(%d)\n", cls);
+    slab_run_t *run = arena->slab_partial[cls];
+    int i, bit;
+
+    if (run == NULL && (run = slab_new_run(cls)) == NULL)
+        return NULL;
+
+    /* A partial run has a free bit somewhere */
+    for (i = 0; run->map[i] == 0; i++)
+        ;
+    bit = __builtin_ctz(run->map[i]);
+    run->map[i] &= ~(1U << bit);
+
+    /* Full runs leave the partial list, they come back on their next free */
+    if (--run->nfree == 0) {
+        arena->slab_partial[cls] = run->next;
+        if (run->next != NULL)
+            run->next->prev = NULL;
+    }
+    return SLAB_OBJS(run) + (size_t)(i * 32 + bit) * SLAB_OBJSIZE(cls);
+}
+
+/*
+ * slab_free - Return object ptr to its run. An empty run goes back to the heap
+ *             unless it is the last partial run of its class.
+ */
+static void slab_free(void *ptr)
+{
+    DBG_PRINTF("Entering slab_free(%p)\n", ptr);
+    slab_run_t *run = SLAB_RUN(ptr);
+    unsigned int cls = run->cls;
+    size_t idx = ((char *)ptr - SLAB_OBJS(run)) / SLAB_OBJSIZE(cls);
+
+    run->map[idx / 32] |= 1U << (idx % 32);
+
+    /* Full run gets a free object, put it back on the partial list */
+    if (run->nfree++ == 0) {
+        run->prev = NULL;
+        run->next = arena->slab_partial[cls];
+        if (run->next != NULL)
+            run->next->prev = run;
+        arena->slab_partial[cls] = run;
+    }
+
+    if (run->nfree == SLAB_NOBJS(cls) && (run->prev != NULL || run->next != NULL)) {
+        if (run->prev != NULL)
+            run->prev->next = run->next;
+        else
+            arena->slab_partial[cls] = run->next;
+        if (run->next != NULL)
+            run->next->prev = run->prev;
+        arena->slab_pages[SLAB_PAGE(run) / 32] &= ~(1U << (SLAB_PAGE(run) % 32));
+        free_block(run);
+    }
+}
+
+/*
+ * slab_new_run - Carve a run for slab class cls from the end of the heap. The run is an allocated block
+ *                starting on a SLAB_RUNSIZE boundary, the gap before it becomes a free block.
+ * Return: the run, it is the only partial run of its class.
+ */
+static slab_run_t *slab_new_run(int cls)
+{
+    DBG_PRINTF("Entering slab_new_run(%d)\n", cls);
+    char *bp = (char *)ARENA_HEAP_HI() + 1;
+    size_t pad = (SLAB_RUNSIZE - (bp - arena->seglist_start) % SLAB_RUNSIZE) % SLAB_RUNSIZE;
+    slab_run_t *run;
+    unsigned int n, i;
+
+    /* Pad the heap up to the next run boundary, the padding must be able to hold a free block */
+    if (pad != 0 && pad < MINBLOCKSIZE)
+        pad += SLAB_RUNSIZE;
+    if (pad != 0 && extend_heap(pad / WSIZE) == NULL)
+        return NULL;
+    if ((bp = ARENA_SBRK(SLAB_RUNSIZE)) == (void *)-1)
+        return NULL;
+    PUT(HDRP(bp), PACK(SLAB_RUNSIZE, GET_PREV_ALLOC(HDRP(bp)) | 1));
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 3)); /* New epilogue header */
+
+    /* The run ends the heap now, the old top chunk is an ordinary free block */
+    if (arena->top != NULL) {
+        char *top = arena->top;
+        arena->top = NULL;
+        insert(top);
+    }
+
+    /* Set up the run: every object is free */
+    run = (slab_run_t *)bp;
+    n = SLAB_NOBJS(cls);
+    run->next = run->prev = NULL;
+    run->cls = cls;
+    run->nfree = n;
+    for (i = 0; i < SLAB_MAPWORDS; i++)
+        run->map[i] = i < n / 32 ? ~0U : (i == n / 32 ? (1U << (n % 32)) - 1 : 0);
+    arena->slab_pages[SLAB_PAGE(run) / 32] |= 1U << (SLAB_PAGE(run) % 32);
+    arena->slab_partial[cls] = run;
+    return run;
+}
+
+/*
+ * insert - Insert given block pointer to the head of free list, or make it the top chunk if it is the last block.
+ * insert() is called by free() or place()
+ */
+static void insert(void* bp)
+{
+    DBG_PRINTF("Entering insert(%p)\n", bp);
+
+    if (GET_SIZE(HDRP(NEXT_BLKP(bp))) == 0) {
+        arena->top = bp;
+        return;
+    }
+    if (GET_SIZE(HDRP(bp)) >= TREE_MIN) {
+        tree_insert(bp);
+        return;
+    }
+
+    /* Locate freelist */
+    int offset = LIST_OFFSET(GET_SIZE(HDRP(bp)));
+    char **ptr_to_freelist_headp = SEGLIST_HEADP(offset);
+    DBG_PRINTF("LIST_OFFSET: %d\n", offset);
+    arena->freelist_headp = *ptr_to_freelist_headp;
+
+#ifdef ADDR_ORDER
+    *ptr_to_freelist_headp = addr_insert(arena->freelist_headp, bp);
+    arena->seglist_bitmap |= 1ULL << offset;
+    return;
+#endif
+
+    /* List is NULL, make bp as list head */
+    if (arena->freelist_headp == NULL) {
+        DBG_PRINTF("Free list is NULL, make %p the head of free list\n", bp);
+        SET_FDP(bp, NULL);
+        SET_BKP(bp, NULL);
+    }
+    /* insert */
+    else {
+        DBG_PRINTF("Free list not null,  %p will be new head\n", bp);
+        /* Set up current block */
+        SET_FDP(bp, arena->freelist_headp);
+        SET_BKP(bp, 0);
+        /* Set up next block */
+        SET_BKP(arena->freelist_headp, bp);
+    }
+
+    /* Free list head is np now */
+    *ptr_to_freelist_headp = bp;
+    arena->seglist_bitmap |= 1ULL << offset;
+    return;
+}
+/*
+ * delete - Remove given block pointer from free list.
+ * delete() is called by place() or coalesce();
+ * we dont' call delete() when there's no free block, so what we deleted is what we inserted.
+ */
+static void delete(void* bp)
+{
+    DBG_PRINTF("Entering delete(%p)\n", bp);
+
+    if (bp == arena->top) {
+        arena->top = NULL;
+        return;
+    }
+    if (GET_SIZE(HDRP(bp)) >= TREE_MIN) {
+        tree_delete(bp);
+        return;
+    }
 
     /* Locate freelist */
-    char **ptr_to_freelist_headp = (char **)(seglist_start + LIST_OFFSET(GET_SIZE(HDRP(bp))) * WSIZE);
-    DBG_PRINTF("LIST_OFFSET: %d\n", LIST_OFFSET(GET_SIZE(HDRP(bp))));
+    int offset = LIST_OFFSET(GET_SIZE(HDRP(bp)));
+    char **ptr_to_freelist_headp = SEGLIST_HEADP(offset);
+    DBG_PRINTF("LIST_OFFSET: %d\n", offset);
+
+#ifdef ADDR_ORDER
+    if ((*ptr_to_freelist_headp = addr_delete(*ptr_to_freelist_headp, bp)) == NULL)
+        arena->seglist_bitmap &= ~(1ULL << offset);
+    return;
+#endif
+
     /* Only one free block */
     if(BKP(bp) == NULL && FDP(bp) == NULL) {
         DBG_PRINTF("Only one free block\n");
         *ptr_to_freelist_headp = NULL;
+        arena->seglist_bitmap &= ~(1ULL << offset);
     }
     /* More than one free block, delete the first block */
     else if (BKP(bp) == NULL) {
@@ -523,21 +1970,321 @@ static void delete(void* bp)
     }
 }
 
-static void check_freelist()
+/*
+ * rotate_up - Rotate node bp above its parent, keeping the tree order.
+ */
+static void rotate_up(char *bp)
+{
+    char *parent = PARENT(bp);
+    char *grandparent = PARENT(parent);
+
+    if (LEFT(parent) == bp) {
+        SET_LEFT(parent, RIGHT(bp));
+        if (RIGHT(bp) != NULL)
+            SET_PARENT(RIGHT(bp), parent);
+        SET_RIGHT(bp, parent);
+    }
+    else {
+        SET_RIGHT(parent, LEFT(bp));
+        if (LEFT(bp) != NULL)
+            SET_PARENT(LEFT(bp), parent);
+        SET_LEFT(bp, parent);
+    }
+    SET_PARENT(parent, bp);
+    SET_PARENT(bp, grandparent);
+
+    if (grandparent == NULL)
+        arena->tree_root = bp;
+    else if (LEFT(grandparent) == parent)
+        SET_LEFT(grandparent, bp);
+    else
+        SET_RIGHT(grandparent, bp);
+}
+
+/*
+ * tree_insert - Insert free block bp as a leaf, then rotate it up while its priority beats its parent's.
+ */
+static void tree_insert(void *bp)
+{
+    DBG_PRINTF("Entering tree_insert(%p)\n", bp);
+    char *parent = NULL, *cur = arena->tree_root;
+
+    while (cur != NULL) {
+        parent = cur;
+        cur = TREE_LESS(bp, cur) ? LEFT(cur) : RIGHT(cur);
+    }
+    SET_LEFT(bp, NULL);
+    SET_RIGHT(bp, NULL);
+    SET_PARENT(bp, parent);
+    if (parent == NULL)
+        arena->tree_root = bp;
+    else if (TREE_LESS(bp, parent))
+        SET_LEFT(parent, bp);
+    else
+        SET_RIGHT(parent, bp);
+
+    while (PARENT(bp) != NULL && PRIORITY(bp) > PRIORITY(PARENT(bp)))
+        rotate_up(bp);
+}
+
+/*
+ * tree_delete - Rotate node bp down below its higher priority child until it is a leaf, then cut it off.
+ */
+static void tree_delete(void *bp)
+{
+    DBG_PRINTF("Entering tree_delete(%p)\n", bp);
+    char *left, *right, *parent;
+
+    for (;;) {
+        left = LEFT(bp);
+        right = RIGHT(bp);
+        if (left == NULL && right == NULL)
+            break;
+        if (right == NULL || (left != NULL && PRIORITY(left) > PRIORITY(right)))
+            rotate_up(left);
+        else
+            rotate_up(right);
+    }
+
+    parent = PARENT(bp);
+    if (parent == NULL)
+        arena->tree_root = NULL;
+    else if (LEFT(parent) == bp)
+        SET_LEFT(parent, NULL);
+    else
+        SET_RIGHT(parent, NULL);
+}
+
+/*
+ * tree_find - Best fit: the smallest (then lowest) tree node of at least asize bytes, NULL if none.
+ */
+static void *tree_find(size_t asize)
+{
+    char *best = NULL;
+
+    for (char *cur = arena->tree_root; cur != NULL; ) {
+        if (GET_SIZE(HDRP(cur)) >= asize) {
+            best = cur;
+            cur = LEFT(cur);
+        }
+        else
+            cur = RIGHT(cur);
+    }
+    DBG_PRINTF("tree_find: %p\n", best);
+    return best;
+}
+
+#ifdef ADDR_ORDER
+/*
+ * addr_update - Recompute the subtree max of treap node bp from its own size and its children's.
+ * Return: bp.
+ */
+static char *addr_update(char *bp)
+{
+    unsigned int max = GET_SIZE(HDRP(bp));
+
+    if (LEFT(bp) != NULL)
+        max = MAX(max, SUBTREE_MAX(LEFT(bp)));
+    if (RIGHT(bp) != NULL)
+        max = MAX(max, SUBTREE_MAX(RIGHT(bp)));
+    SET_SUBTREE_MAX(bp, max);
+    return bp;
+}
+
+/*
+ * addr_insert - Insert free block bp into the address ordered treap at root.
+ * Return: the new root.
+ */
+static char *addr_insert(char *root, char *bp)
+{
+    char *child;
+
+    if (root == NULL) {
+        SET_LEFT(bp, NULL);
+        SET_RIGHT(bp, NULL);
+        return addr_update(bp);
+    }
+
+    /* Insert below, then rotate the child up if it beats us */
+    if (bp < root) {
+        child = addr_insert(LEFT(root), bp);
+        SET_LEFT(root, child);
+        if (PRIORITY(child) > PRIORITY(root)) {
+            SET_LEFT(root, RIGHT(child));
+            addr_update(root);
+            SET_RIGHT(child, root);
+            return addr_update(child);
+        }
+    }
+    else {
+        child = addr_insert(RIGHT(root), bp);
+        SET_RIGHT(root, child);
+        if (PRIORITY(child) > PRIORITY(root)) {
+            SET_RIGHT(root, LEFT(child));
+            addr_update(root);
+            SET_LEFT(child, root);
+            return addr_update(child);
+        }
+    }
+    return addr_update(root);
+}
+
+/*
+ * addr_delete - Remove free block bp from the address ordered treap at root, its children take its place.
+ * Return: the new root.
+ */
+static char *addr_delete(char *root, char *bp)
+{
+    char *child;
+
+    /* SET_LINK() may evaluate its value twice, so the recursion goes into a variable first */
+    if (root == bp)
+        return addr_merge(LEFT(bp), RIGHT(bp));
+    if (bp < root) {
+        child = addr_delete(LEFT(root), bp);
+        SET_LEFT(root, child);
+    }
+    else {
+        child = addr_delete(RIGHT(root), bp);
+        SET_RIGHT(root, child);
+    }
+    return addr_update(root);
+}
+
+/*
+ * addr_merge - Join treaps lo and hi, every node of lo lying below every node of hi.
+ * Return: the root of the joined treap.
+ */
+static char *addr_merge(char *lo, char *hi)
+{
+    char *child;
+
+    if (lo == NULL)
+        return hi;
+    if (hi == NULL)
+        return lo;
+    if (PRIORITY(lo) > PRIORITY(hi)) {
+        child = addr_merge(RIGHT(lo), hi);
+        SET_RIGHT(lo, child);
+        return addr_update(lo);
+    }
+    child = addr_merge(lo, LEFT(hi));
+    SET_LEFT(hi, child);
+    return addr_update(hi);
+}
+
+/*
+ * addr_first_fit - The lowest block of at least asize bytes in the address ordered treap at root, NULL if none.
+ *                  The subtree maxima tell which way the fit lies, so it walks a single path down.
+ */
+static char *addr_first_fit(char *root, size_t asize)
+{
+    if (root == NULL || SUBTREE_MAX(root) < asize)
+        return NULL;
+    for (;;) {
+        if (LEFT(root) != NULL && SUBTREE_MAX(LEFT(root)) >= asize)
+            root = LEFT(root);
+        else if (GET_SIZE(HDRP(root)) >= asize)
+            return root;
+        else
+            root = RIGHT(root);
+    }
+}
+
+/*
+ * addr_lowest - The lowest block of the non-empty address ordered treap at root.
+ */
+static char *addr_lowest(char *root)
+{
+    while (LEFT(root) != NULL)
+        root = LEFT(root);
+    return root;
+}
+
+/*
+ * check_addr_tree - Check the address order, heap order, subtree maxima and size class of the treap at bp,
+ *                   its nodes lying between lo and hi.
+ * Return: number of nodes.
+ */
+static int check_addr_tree(char *bp, char *lo, char *hi, int i)
+{
+    unsigned int max;
+
+    if (bp == NULL)
+        return 0;
+    max = GET_SIZE(HDRP(bp));
+    if (LEFT(bp) != NULL)
+        max = MAX(max, SUBTREE_MAX(LEFT(bp)));
+    if (RIGHT(bp) != NULL)
+        max = MAX(max, SUBTREE_MAX(RIGHT(bp)));
+    if (bp <= lo || bp >= hi || GET_ALLOC(HDRP(bp)) || LIST_OFFSET(GET_SIZE(HDRP(bp))) != i
+        || (LEFT(bp) != NULL && PRIORITY(LEFT(bp)) > PRIORITY(bp))
+        || (RIGHT(bp) != NULL && PRIORITY(RIGHT(bp)) > PRIORITY(bp))
+        || SUBTREE_MAX(bp) != max) {
+        printf("Free list %d node %p(size: %u) malformed!\n", i, bp, GET_SIZE(HDRP(bp)));
+        exit(1);
+    }
+    return 1 + check_addr_tree(LEFT(bp), lo, bp, i) + check_addr_tree(RIGHT(bp), bp, hi, i);
+}
+#endif
+
+/*
+ * check_tree - Check order, heap order, parent links and sizes of the subtree at bp.
+ * Return: number of nodes.
+ */
+static int check_tree(char *bp, char *parent)
+{
+    if (bp == NULL)
+        return 0;
+    if (PARENT(bp) != parent || GET_ALLOC(HDRP(bp)) || GET_SIZE(HDRP(bp)) < TREE_MIN || bp == arena->top
+        || (LEFT(bp) != NULL && (!TREE_LESS(LEFT(bp), bp) || PRIORITY(LEFT(bp)) > PRIORITY(bp)))
+        || (RIGHT(bp) != NULL && (!TREE_LESS(bp, RIGHT(bp)) || PRIORITY(RIGHT(bp)) > PRIORITY(bp)))) {
+        printf("Tree node %p(size: %u) malformed!\n", bp, GET_SIZE(HDRP(bp)));
+        exit(1);
+    }
+    return 1 + check_tree(LEFT(bp), bp) + check_tree(RIGHT(bp), bp);
+}
+
+/*
+ * check_freelist - Check the free lists, the bitmap and the tree, dumping them if verbose is set.
+ */
+static void check_freelist(int verbose)
 {
-    printf("---------------CHECK FREE LIST START----------------------\n");
-    for ( int i = 0; i < 10; i++) {
+    int count;
+
+    if (verbose)
+        printf("---------------CHECK FREE LIST START----------------------\n");
+    for ( int i = 0; i < NUM_CLASSES; i++) {
         DBG_PRINTF("LIST_OFFSET: %d\n", i);
-        freelist_headp = *(char **)(seglist_start + i * WSIZE);
-        printf("freelist_headp: %p\n", freelist_headp);
+        arena->freelist_headp = *SEGLIST_HEADP(i);
+        if (verbose)
+            printf("freelist_headp: %p\n", arena->freelist_headp);
+        /* Check if bitmap agrees with the list */
+        if (!(arena->seglist_bitmap & (1ULL << i)) != (arena->freelist_headp == NULL)) {
+            printf("Free list bitmap out of sync!\n");
+            exit(1);
+        }
+#ifdef ADDR_ORDER
+        count = check_addr_tree(arena->freelist_headp, NULL, (char *)~0UL, i);
+        if (verbose)
+            printf("Free list: %d blocks\n", count);
+        continue;
+#endif
         char *cur, *next;
-        if ((cur = freelist_headp) != NULL)
+        if ((cur = arena->freelist_headp) != NULL)
         {
-            printf("Free List: %p<-", BKP(cur));
+            if (verbose)
+                printf("Free List: %p<-", BKP(cur));
             while(cur != NULL)
             {
                 next = FDP(cur);
-                printf("%p(size: %u)->", cur, GET_SIZE(HDRP(cur)));
+                if (verbose)
+                    printf("%p(size: %u)->", cur, GET_SIZE(HDRP(cur)));
+                /* Check if block sits in the list of its size class, the top chunk in none */
+                if (LIST_OFFSET(GET_SIZE(HDRP(cur))) != i || cur == arena->top) {
+                    printf("\nBlock in wrong size class, expect %d!\n", LIST_OFFSET(GET_SIZE(HDRP(cur))));
+                    exit(1);
+                }
                 /* Check if next free block points to us */
                 if(next != NULL && BKP(next) != cur) {
                     printf("\nNext free block does not point to current block!\n");
@@ -545,20 +2292,80 @@ static void check_freelist()
                 }
                 cur = next;
             }
-            printf("%p\n", NULL);
+            if (verbose)
+                printf("%p\n", NULL);
         }
-        else
+        else if (verbose)
         {
             printf("Free List is NULL.\n");
         }
     }
 
-    printf("--------------- CHECK FREE LIST END ----------------------\n");
+    count = check_tree(arena->tree_root, NULL);
+    if (verbose) {
+        printf("Free tree: %d nodes\n", count);
+        printf("--------------- CHECK FREE LIST END ----------------------\n");
+    }
+}
+
+static void check_slabs()
+{
+    for (int c = 0; c < SLAB_CLASSES; c++) {
+        for (slab_run_t *run = arena->slab_partial[c]; run != NULL; run = run->next) {
+            unsigned int nfree = 0;
+            for (int i = 0; i < SLAB_MAPWORDS; i++)
+                nfree += __builtin_popcount(run->map[i]);
+            /* Partial runs are registered, of their class, and count their free objects right */
+            if (!IS_SLAB(run) || run->cls != c || run->nfree == 0 || run->nfree != nfree) {
+                printf("Slab run %p malformed! class: %u, nfree: %u, free bits: %u\n", run, run->cls, run->nfree, nfree);
+                exit(1);
+            }
+            if (run->next != NULL && run->next->prev != run) {
+                printf("Next slab run does not point to current run!\n");
+                exit(1);
+            }
+        }
+    }
+}
+
+static void check_fastbins()
+{
+    for (int i = 0; i < FASTBINS; i++) {
+        if (!(arena->fastbin_bitmap & (1ULL << i)) != (arena->fastbins[i] == NULL)) {
+            printf("Fastbin bitmap out of sync!\n");
+            exit(1);
+        }
+        /* Fastbin chunks stay marked allocated and have the size of their bin */
+        for (char *bp = arena->fastbins[i]; bp != NULL; bp = FDP(bp)) {
+            if (!GET_ALLOC(HDRP(bp)) || IS_SLAB(bp) || FASTBIN_INDEX(GET_SIZE(HDRP(bp))) != i) {
+                printf("Fastbin %d chunk %p(size: %u) malformed!\n", i, bp, GET_SIZE(HDRP(bp)));
+                exit(1);
+            }
+        }
+    }
+}
+
+#if HEAP_CHECK == 1
+/*
+ * check_size - Check that a block freed by mm_free_sized() was asked for with size bytes.
+ */
+static void check_size(void *bp, size_t size)
+{
+    size_t avail = usable_size(bp);
+
+    if (size == 0 || size > avail || (IS_SLAB(bp) && SLAB_CLASS(size) != SLAB_RUN(bp)->cls)) {
+        printf("mm_free_sized(%p, %zu): block of %zu usable bytes (%s)!\n", bp, size, avail,
+               IS_SLAB(bp) ? "slab object" : "chunk");
+        exit(1);
+    }
 }
+#endif
 
 static void mm_checkheap(int verbose)
 {
-    check_freelist();
+    check_freelist(verbose);
+    check_slabs();
+    check_fastbins();
     /* 
      * What we need to check:
      * Check epilogue and prologue blocks
@@ -567,7 +2374,7 @@ static void mm_checkheap(int verbose)
      * Check each block’s header and footer: size(minimum size, slignment), previous/net allocate/free bit consistency, header and footer matching each other
      * Check coalescing: no two consecutive free blocks in the heap
      */
-    char *header_start = heap_listp + 11 * WSIZE; /* Prologue header */
+    char *header_start = arena->heap_listp; /* Prologue header */
     /* Check prologue header */
     if (GET_SIZE(header_start) != DSIZE || GET_ALLOC(header_start) != 1) {
         printf("Prologue Header Malformed. Size: %d, Alloc: %d\n", GET_SIZE(header_start), GET_ALLOC(header_start));
@@ -586,15 +2393,38 @@ static void mm_checkheap(int verbose)
             printf("Address not aligned!\n");
             exit(1);
         }
-        /* No adjacent free block */
+        /* Free blocks need matching footer */
+        if (!GET_ALLOC(header) && GET(header) != GET(header + GET_SIZE(header) - WSIZE)) {
+            printf("Header and footer mismatch at %p\n", header);
+            exit(1);
+        }
+        /* Slab runs are allocated, page sized blocks */
+        if (IS_SLAB(header + WSIZE) && (!GET_ALLOC(header) || GET_SIZE(header) != SLAB_RUNSIZE
+                                        || (header + WSIZE - arena->seglist_start) % SLAB_RUNSIZE)) {
+            printf("Slab run at %p malformed!\n", header + WSIZE);
+            exit(1);
+        }
+        /* Next block knows our allocation status */
         char *next = header + GET_SIZE(header);
+        if (!GET_PREV_ALLOC(next) != !GET_ALLOC(header)) {
+            printf("Prev alloc bit of %p out of sync!\n", next);
+            exit(1);
+        }
+        /* No adjacent free block */
         if (!GET_ALLOC(header) && !GET_ALLOC(next)) {
                 printf("Adjacent free block!\n");
                 printf("Current header: %p, size: %d alloc: %dx\n", header, GET_SIZE(header), GET_ALLOC(header));
                 printf("Next header: %p, size: %d alloc: %dx\n", header, GET_SIZE(next), GET_ALLOC(next));
-                check_freelist();
+                check_freelist(1);
                 exit(1);
         }
         header = next;
     }
+
+    /* The last block is free iff it is the top chunk */
+    if (!GET_PREV_ALLOC(header) != (arena->top != NULL)
+        || (arena->top != NULL && NEXT_BLKP(arena->top) != header + WSIZE)) {
+        printf("Top chunk %p out of sync!\n", arena->top);
+        exit(1);
+    }
 }
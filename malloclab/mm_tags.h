@@ -0,0 +1,47 @@
+#ifndef __MM_TAGS_H_
+#define __MM_TAGS_H_
+
+/*
+ * mm_tags.h - Boundary tag macros shared by the allocators: header and
+ *     footer words, their size and status bits, and the walk from a
+ *     block to its neighbours. ALIGNMENT comes from config.h.
+ */
+
+#include "config.h"
+
+/* Rounds up to the nearest multiple of ALIGNMENT */
+#define ALIGN(size) (((size) + (ALIGNMENT-1)) & ~(ALIGNMENT-1))
+
+/* Basic constants and macros: */
+#define WSIZE      4          /* Word and header/footer size (bytes) */
+#define DSIZE      8          /* Doubleword size (bytes) */
+#define PSIZE      sizeof(char *) /* Pointer size (bytes) */
+
+/* Max value of 2 values */
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+
+/* Pack a size and allocated bit into a word */
+#define PACK(size, alloc)  ((size) | (alloc))
+
+/* Read and write a word at address p. */
+#define GET(p)       (*(unsigned int *)(p))
+#define PUT(p, val)  (*(unsigned int *)(p) = (val))
+
+/* Read the size and allocated fields from address p */
+#define GET_SIZE(p)        (GET(p) & ~0x7)
+#define GET_ALLOC(p)       (GET(p) & 0x1)
+#define GET_PREV_ALLOC(p)  (GET(p) & 0x2)
+
+/* Set and clear prev_alloc status at adress p*/
+#define SET_PREV_ALLOC(p) (PUT(p, GET(p) | 0x2))
+#define CLR_PREV_ALLOC(p) (PUT(p, GET(p) & ~0x2))
+
+/* Given block ptr bp, compute address of its header and footer (blocks that have one) */
+#define HDRP(bp)  ((char *)(bp) - WSIZE)
+#define FTRP(bp)  ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
+
+/* Given block ptr bp, compute address of next and previous blocks, the previous one must have a footer */
+#define NEXT_BLKP(bp)  ((char *)(bp) + GET_SIZE(HDRP(bp)))
+#define PREV_BLKP(bp)  ((char *)(bp) - GET_SIZE((char *)(bp) - DSIZE))
+
+#endif /* __MM_TAGS_H_ */
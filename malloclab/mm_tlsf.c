@@ -0,0 +1,619 @@
+/*
+   mm.c - Malloc package using Two-Level Segregated Fit (TLSF).
+
+   Chunk details:
+    Chunks use the same `boundary tag' layout as the segregated list
+    allocator: a one word header and a one word footer holding the
+    chunk size and the A (ALLOCATED) bit, with the forward and back
+    pointers of free chunks stored in the first two payload words.
+
+    Free chunks are kept in a two-level array of doubly-linked lists.
+    The first level splits sizes into powers of two, the second level
+    splits each power of two into SL_INDEX_COUNT linear ranges:
+
+        fl = index of the highest set bit of size
+        sl = the next SL_INDEX_COUNT_LOG2 bits of size below that bit
+
+    Sizes smaller than SMALL_BLOCK_SIZE all go to first level 0 and are
+    split linearly by ALIGNMENT.
+
+    Two bitmaps remember which lists are non-empty:
+
+        fl_bitmap        bit i set <=> some list of first level i is non-empty
+        sl_bitmap[i]     bit j set <=> list (i, j) is non-empty
+
+    find_fit() rounds the request up to the next second level range, so
+    any chunk of the list it picks is big enough, then finds the first
+    non-empty list with one `ctz' on each bitmap. malloc and free never
+    walk a free list, so both run in bounded time no matter how many
+    free chunks there are.
+
+   Heap structure:
+        heap start-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-
+        |                 4 btes padding                  |
+        prologue header-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+        |             Size of chunk, in bytes           |A|
+        prologue footer->-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+        |             Size of chunk, in bytes           |A|
+        free and allocated chunks-> +-+-+-+-+-+-+-+-+-+-+-+
+	    |                                                 .
+	    .                                                 .
+        .                                                 |
+        epilogue header->-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+	    |             Size of chunk, in bytes           |A|
+        +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+
+    The list heads and bitmaps are too big to live in front of the
+    prologue (FL_INDEX_COUNT * SL_INDEX_COUNT words), so they are kept
+    in static storage and reset by mm_init().
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "mm_tags.h"
+
+/*********************************************************
+ * NOTE TO STUDENTS: Before you do anything else, please
+ * provide your team information in the following struct.
+ ********************************************************/
+team_t team = {
+    /* Team name */
+    "ateam",
+    /* First member's full name */
+    "Harry Bovik",
+    /* First member's email address */
+    "bovik@cs.cmu.edu",
+    /* Second member's full name (leave blank if none) */
+    "",
+    /* Second member's email address (leave blank if none) */
+    ""
+};
+/*
+  Debugging macros:
+*/
+#define DEBUG 0
+#define HEAP_CHECK 0
+
+#if DEBUG == 1
+# define DBG_PRINTF(...) printf(__VA_ARGS__)
+#else
+# define DBG_PRINTF(...)
+#endif
+
+#if HEAP_CHECK == 1
+#define CHECKHEAP(verbose) mm_checkheap(verbose)
+#else
+#define CHECKHEAP(verbose)
+#endif
+
+/* Basic constants, the boundary tag macros are in mm_tags.h */
+#define CHUNKSIZE  (1<<12)    /* Extend heap by this amount (bytes) */
+#define MINBLOCKSIZE ALIGN(DSIZE + 2 * PSIZE) /* Minimum block size: WORD(HDR) + PTR(FDP) + PTR(BKP) + WORD(FTR), 16 or 32 */
+
+/* TLSF index parameters */
+#define SL_INDEX_COUNT_LOG2 4     /* log2 of number of second level lists per first level */
+#define ALIGN_SIZE_LOG2     (ALIGNMENT == 16 ? 4 : 3) /* log2 of ALIGNMENT */
+#define FL_INDEX_MAX        30    /* largest supported block is just below 1 << (FL_INDEX_MAX + 1) */
+
+#define SL_INDEX_COUNT   (1 << SL_INDEX_COUNT_LOG2)
+#define FL_INDEX_SHIFT   (SL_INDEX_COUNT_LOG2 + ALIGN_SIZE_LOG2)
+#define FL_INDEX_COUNT   (FL_INDEX_MAX - FL_INDEX_SHIFT + 2)
+#define SMALL_BLOCK_SIZE (1 << FL_INDEX_SHIFT)
+
+/* Given block ptr bp, get value of foward and back pointer of that chunk (note those are different from HDRP() adn FTRP()) */
+#define FDP(bp)  (*(char **)(bp))
+#define BKP(bp)  (*(char **)((char *)(bp) + PSIZE))
+
+/* Given block ptr bp, set forward and back pointer's value of that block by given value*/
+#define SET_FDP(bp, fdp) (FDP(bp) = fdp)
+#define SET_BKP(bp, bkp) (BKP(bp) = bkp)
+
+/* Index of the highest (fls) and lowest (ffs) set bit of a non-zero word */
+#define FLS(x)  (31 - __builtin_clz(x))
+#define FFS(x)  (__builtin_ctz(x))
+
+/* Global declarations */
+static char *heap_listp;
+static unsigned int fl_bitmap;                   /* non-empty first levels */
+static unsigned int sl_bitmap[FL_INDEX_COUNT];   /* non-empty second levels */
+static char *blocks[FL_INDEX_COUNT][SL_INDEX_COUNT]; /* free list heads */
+
+/* Function prototypes for internal helper routines */
+static void *coalesce(void *bp);
+static void *extend_heap(size_t words);
+static void *find_fit(size_t asize);
+static void place(void *bp, size_t asize);
+static void mapping_insert(size_t size, int *fli, int *sli);
+static void mapping_search(size_t size, int *fli, int *sli);
+static void insert(void *bp); /* insert a free block to free list */
+static void delete(void *bp); /* delete a free block from free list */
+static void mm_checkheap(int verbose);
+
+/*
+ * mm_init - initialize the malloc package.
+ */
+int mm_init(void)
+{
+    /* Create the initial empty heap */
+    if ((heap_listp = mem_sbrk(4*WSIZE)) == (void *) -1)
+        return -1;
+    PUT(heap_listp, 0);                             /* alignment padding */
+    PUT(heap_listp + (1*WSIZE), PACK(DSIZE, 1));    /* Prologue header */
+    PUT(heap_listp + (2*WSIZE), PACK(DSIZE, 1));    /* Prologue footer */
+    PUT(heap_listp + (3*WSIZE), PACK(0, 1));        /* Epilogue header */
+
+    /* mdriver calls mm_init() once per trace, forget the old heap */
+    fl_bitmap = 0;
+    memset(sl_bitmap, 0, sizeof(sl_bitmap));
+    memset(blocks, 0, sizeof(blocks));
+
+    /* Extend the empty heap with a free block of CHUNKSIZE bytes */
+    if (extend_heap(CHUNKSIZE/WSIZE) == NULL)
+        return -1;
+    return 0;
+}
+
+/*
+ * mm_malloc - Allocate a block from the first non-empty list whose
+ *             chunks are all at least the adjusted request size.
+ */
+void *mm_malloc(size_t size)
+{
+    DBG_PRINTF("Entering mm_malloc(%zu)\n", size);
+    CHECKHEAP(0);
+    size_t asize; /* Adjusted block size */
+    size_t extendsize; /* Amount to extend heap if not fit */
+    char *bp;
+
+    /* Ignore spurious requests */
+    if (size == 0) {
+        return NULL;
+    }
+
+    /* Adjust block size to include overhead and alignment reqs */
+    asize = MAX(ALIGN(size + DSIZE), MINBLOCKSIZE);
+
+    /* Search the free lists for a fit */
+    if ((bp = find_fit(asize)) != NULL) {
+        place(bp, asize);
+        return bp;
+    }
+
+    /* No fit. Get more memory and place the block */
+    extendsize = MAX(asize, CHUNKSIZE);
+    if ((bp = extend_heap(extendsize / WSIZE)) == NULL)
+        return NULL;
+    place(bp, asize);
+    return bp;
+}
+
+/*
+ * mm_free - Freeing a block and coalesce if necessary.
+ */
+void mm_free(void *bp)
+{
+    DBG_PRINTF("Entering mm_free(%p)\n", bp);
+    CHECKHEAP(0);
+    if (bp == NULL)
+        return;
+    PUT(HDRP(bp), PACK(GET_SIZE(HDRP(bp)), 0));
+    PUT(FTRP(bp), PACK(GET_SIZE(HDRP(bp)), 0));
+    coalesce(bp);
+}
+
+/*
+ * mm_realloc - Implemented simply in terms of mm_malloc and mm_free
+ */
+void *mm_realloc(void *ptr, size_t size)
+{
+    DBG_PRINTF("Entering mm_realloc(%p, %zu)\n", ptr, size);
+    CHECKHEAP(0);
+    void *oldptr = ptr;
+    void *newptr;
+    size_t copySize;
+
+    if (ptr == NULL)
+        return mm_malloc(size);
+    if (size == 0) {
+        mm_free(ptr);
+        return NULL;
+    }
+
+    newptr = mm_malloc(size);
+    if (newptr == NULL)
+        return NULL;
+    size = GET_SIZE(HDRP(oldptr));
+    copySize = GET_SIZE(HDRP(newptr));
+    if (size < copySize)
+        copySize = size;
+    memcpy(newptr, oldptr, copySize-DSIZE);
+    mm_free(oldptr);
+    return newptr;
+}
+
+/*
+ * mm_calloc - Allocate a zeroed block for nmemb elements of size bytes.
+ */
+void *mm_calloc(size_t nmemb, size_t size)
+{
+    void *bp;
+
+    if (nmemb != 0 && size > SIZE_MAX / nmemb)
+        return NULL;
+    size *= nmemb;
+    if ((bp = mm_malloc(size)) != NULL)
+        memset(bp, 0, size);
+    return bp;
+}
+
+/*
+ * mm_memalign - Allocate a block whose payload is aligned to alignment, a power of two.
+ *               Over-allocate, then give the gap in front of the aligned payload and the
+ *               tail behind the requested size back as free blocks.
+ */
+void *mm_memalign(size_t alignment, size_t size)
+{
+    DBG_PRINTF("Entering mm_memalign(%zu, %zu)\n", alignment, size);
+    size_t asize, gap, bsize;
+    char *bp, *abp;
+
+    if (size == 0 || (alignment & (alignment - 1)))
+        return NULL;
+    if (alignment <= ALIGNMENT)
+        return mm_malloc(size);
+
+    asize = MAX(ALIGN(size + DSIZE), MINBLOCKSIZE);
+    if ((bp = mm_malloc(asize + alignment + MINBLOCKSIZE)) == NULL)
+        return NULL;
+
+    /* The gap in front of the aligned payload must be able to hold a free block */
+    abp = (char *)(((uintptr_t)bp + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    if (abp != bp && abp - bp < MINBLOCKSIZE)
+        abp += alignment;
+    if (abp != bp) {
+        gap = abp - bp;
+        PUT(HDRP(abp), PACK(GET_SIZE(HDRP(bp)) - gap, 1));
+        PUT(FTRP(abp), PACK(GET_SIZE(HDRP(abp)), 1));
+        PUT(HDRP(bp), PACK(gap, 0));
+        PUT(FTRP(bp), PACK(gap, 0));
+        coalesce(bp);
+    }
+
+    /* Free the tail, it may border the free remainder of the block we got */
+    bsize = GET_SIZE(HDRP(abp));
+    if (bsize - asize >= MINBLOCKSIZE) {
+        PUT(HDRP(abp), PACK(asize, 1));
+        PUT(FTRP(abp), PACK(asize, 1));
+        PUT(HDRP(NEXT_BLKP(abp)), PACK(bsize - asize, 0));
+        PUT(FTRP(NEXT_BLKP(abp)), PACK(bsize - asize, 0));
+        coalesce(NEXT_BLKP(abp));
+    }
+    return abp;
+}
+
+/*
+ * mm_posix_memalign - mm_memalign() with the POSIX interface: alignment must be a power
+ *                     of two multiple of sizeof(void *), errors are returned, not set in errno.
+ */
+int mm_posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *bp;
+
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)))
+        return EINVAL;
+    if (size == 0) {
+        *memptr = NULL;
+        return 0;
+    }
+    if ((bp = mm_memalign(alignment, size)) == NULL)
+        return ENOMEM;
+    *memptr = bp;
+    return 0;
+}
+
+/*
+ * mm_usable_size - Bytes of block bp the caller may use, up to its footer.
+ */
+size_t mm_usable_size(void *bp)
+{
+    return bp == NULL ? 0 : GET_SIZE(HDRP(bp)) - DSIZE;
+}
+
+/*
+ * mm_malloc_batch - Allocate n blocks of size bytes into out, one by one.
+ * Return: the number of blocks allocated, less than n if the heap is full.
+ */
+size_t mm_malloc_batch(size_t size, size_t n, void **out)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        if ((out[i] = mm_malloc(size)) == NULL)
+            break;
+    return i;
+}
+
+/*
+ * mm_free_batch - Free the n blocks of ptrs, one by one.
+ */
+void mm_free_batch(void **ptrs, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        mm_free(ptrs[i]);
+}
+
+/*
+ * mm_free_sized - The header already holds the block size, so this is mm_free().
+ */
+void mm_free_sized(void *ptr, size_t size)
+{
+    (void)size;
+    mm_free(ptr);
+}
+
+/*
+ * coalesce - Merge freed block with its free neighbours and insert the result.
+ * Return: Pointer of the merged block.
+ */
+static void *coalesce(void *bp)
+{
+    DBG_PRINTF("Entering coalesce(%p)\n", bp);
+
+    void *prev_bp = PREV_BLKP(bp);
+    void *next_bp = NEXT_BLKP(bp);
+
+    size_t prev_alloc = GET_ALLOC(FTRP(prev_bp));
+    size_t next_alloc = GET_ALLOC(HDRP(next_bp));
+
+    size_t current_size = GET_SIZE(HDRP(bp));
+
+    if (!next_alloc) {
+        current_size += GET_SIZE(HDRP(next_bp));
+        delete(next_bp);
+    }
+    if (!prev_alloc) {
+        current_size += GET_SIZE(HDRP(prev_bp));
+        delete(prev_bp);
+        bp = prev_bp;
+    }
+    PUT(HDRP(bp), PACK(current_size, 0));
+    PUT(FTRP(bp), PACK(current_size, 0));
+    insert(bp);
+    return bp;
+}
+
+/*
+ * extend_heap - Extend the heap with a free block and coalesce the new free block if necessary.
+ * Return : new free block's payload address.
+ */
+static void *extend_heap(size_t words)
+{
+    char *bp;
+    size_t size;
+
+    /* Allocate a multiple of ALIGNMENT bytes to maintain alignment */
+    size = ALIGN(words * WSIZE);
+    if ((long)(bp = mem_sbrk(size)) == -1)
+        return NULL;
+
+    /* The old epilogue header becomes the header of the new free block */
+    PUT(HDRP(bp), PACK(size, 0));
+    PUT(FTRP(bp), PACK(size, 0));
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
+
+    /* Coalesce if the previous block was free */
+    return coalesce(bp);
+}
+
+/*
+ * mapping_insert - Compute the (fl, sl) list that a free block of
+ *                  the given size belongs to.
+ */
+static void mapping_insert(size_t size, int *fli, int *sli)
+{
+    int fl, sl;
+
+    if (size < SMALL_BLOCK_SIZE) {
+        /* Small blocks are split linearly */
+        fl = 0;
+        sl = (int)size / (SMALL_BLOCK_SIZE / SL_INDEX_COUNT);
+    }
+    else {
+        fl = FLS(size);
+        sl = (int)(size >> (fl - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+        fl -= (FL_INDEX_SHIFT - 1);
+    }
+    *fli = fl;
+    *sli = sl;
+}
+
+/*
+ * mapping_search - Like mapping_insert(), but round size up to the next
+ *                  list first, so every block in the list found is large enough.
+ */
+static void mapping_search(size_t size, int *fli, int *sli)
+{
+    if (size >= SMALL_BLOCK_SIZE)
+        size += (1 << (FLS(size) - SL_INDEX_COUNT_LOG2)) - 1;
+    mapping_insert(size, fli, sli);
+}
+
+/* find_fit - Find freeblock that fits the request size and return it's bp */
+static void *find_fit(size_t asize)
+{
+    DBG_PRINTF("Entering find_fit(%zu), ", asize);
+    int fl, sl;
+    unsigned int fl_map, sl_map;
+
+    mapping_search(asize, &fl, &sl);
+    if (fl >= FL_INDEX_COUNT)
+        return NULL;
+
+    /* First try the remaining lists of the same first level */
+    sl_map = sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map) {
+        /* Then the smallest non-empty first level above it */
+        fl_map = (fl + 1 < 32) ? fl_bitmap & (~0U << (fl + 1)) : 0;
+        if (!fl_map) {
+            DBG_PRINTF("not found\n");
+            return NULL;
+        }
+        fl = FFS(fl_map);
+        sl_map = sl_bitmap[fl];
+    }
+    sl = FFS(sl_map);
+
+    DBG_PRINTF("found %p in list (%d, %d)\n", blocks[fl][sl], fl, sl);
+    return blocks[fl][sl];
+}
+
+/* place - Place requested block in current free block, split if necessary */
+static void place(void *bp, size_t asize)
+{
+    DBG_PRINTF("Entering place(%p)\n", bp);
+
+    delete(bp);
+
+    size_t size = GET_SIZE(HDRP(bp));
+
+    if ((size - asize) >= MINBLOCKSIZE) {
+        /* set up current block */
+        PUT(HDRP(bp), PACK(asize, 1));
+        PUT(FTRP(bp), PACK(asize, 1));
+
+        /* set up remain block, its next block is allocated so no need to coalesce */
+        PUT(HDRP(NEXT_BLKP(bp)), PACK(size-asize, 0));
+        PUT(FTRP(NEXT_BLKP(bp)), PACK(size-asize, 0));
+        insert(NEXT_BLKP(bp));
+    }
+    else {
+        /* Waste some space, we have no other way */
+        PUT(HDRP(bp), PACK(size, 1));
+        PUT(FTRP(bp), PACK(size, 1));
+    }
+}
+
+/*
+ * insert - Insert given block pointer to the head of its free list
+ *          and mark the list as non-empty.
+ */
+static void insert(void *bp)
+{
+    int fl, sl;
+    char *head;
+
+    mapping_insert(GET_SIZE(HDRP(bp)), &fl, &sl);
+    DBG_PRINTF("Entering insert(%p), list (%d, %d)\n", bp, fl, sl);
+    head = blocks[fl][sl];
+
+    SET_FDP(bp, head);
+    SET_BKP(bp, NULL);
+    if (head != NULL)
+        SET_BKP(head, bp);
+    blocks[fl][sl] = bp;
+
+    fl_bitmap |= 1U << fl;
+    sl_bitmap[fl] |= 1U << sl;
+}
+
+/*
+ * delete - Remove given block pointer from its free list,
+ *          clear the bitmap bits if the list becomes empty.
+ */
+static void delete(void *bp)
+{
+    int fl, sl;
+
+    mapping_insert(GET_SIZE(HDRP(bp)), &fl, &sl);
+    DBG_PRINTF("Entering delete(%p), list (%d, %d)\n", bp, fl, sl);
+
+    if (FDP(bp) != NULL)
+        SET_BKP(FDP(bp), BKP(bp));
+    if (BKP(bp) != NULL)
+        SET_FDP(BKP(bp), FDP(bp));
+    else {
+        /* bp was the list head */
+        blocks[fl][sl] = FDP(bp);
+        if (blocks[fl][sl] == NULL) {
+            sl_bitmap[fl] &= ~(1U << sl);
+            if (!sl_bitmap[fl])
+                fl_bitmap &= ~(1U << fl);
+        }
+    }
+}
+
+static void check_freelist()
+{
+    int fl, sl, i, j;
+
+    for (i = 0; i < FL_INDEX_COUNT; i++) {
+        if (!!(fl_bitmap & (1U << i)) != !!sl_bitmap[i]) {
+            printf("First level bitmap out of sync at %d\n", i);
+            exit(1);
+        }
+        for (j = 0; j < SL_INDEX_COUNT; j++) {
+            char *cur = blocks[i][j];
+            if (!!(sl_bitmap[i] & (1U << j)) != (cur != NULL)) {
+                printf("Second level bitmap out of sync at (%d, %d)\n", i, j);
+                exit(1);
+            }
+            for (; cur != NULL; cur = FDP(cur)) {
+                if (GET_ALLOC(HDRP(cur))) {
+                    printf("Allocated block %p in free list (%d, %d)\n", cur, i, j);
+                    exit(1);
+                }
+                mapping_insert(GET_SIZE(HDRP(cur)), &fl, &sl);
+                if (fl != i || sl != j) {
+                    printf("Block %p(size: %u) in wrong free list (%d, %d)\n",
+                           cur, GET_SIZE(HDRP(cur)), i, j);
+                    exit(1);
+                }
+                if (FDP(cur) != NULL && BKP(FDP(cur)) != cur) {
+                    printf("Next free block does not point to current block!\n");
+                    exit(1);
+                }
+            }
+        }
+    }
+}
+
+static void mm_checkheap(int verbose)
+{
+    check_freelist();
+
+    char *header_start = heap_listp + WSIZE; /* Prologue header */
+    if (GET_SIZE(header_start) != DSIZE || GET_ALLOC(header_start) != 1) {
+        printf("Prologue Header Malformed.\n");
+        exit(1);
+    }
+
+    /* Traverse blocks, check alignment, boundary tags and coalescing */
+    char *header = header_start + DSIZE;
+    while (GET_SIZE(header) != 0) {
+        if ((unsigned long)(header + WSIZE) % ALIGNMENT) {
+            printf("Address not aligned!\n");
+            exit(1);
+        }
+        if (GET(header) != GET(header + GET_SIZE(header) - WSIZE)) {
+            printf("Header and footer mismatch at %p\n", header);
+            exit(1);
+        }
+        char *next = header + GET_SIZE(header);
+        if (!GET_ALLOC(header) && !GET_ALLOC(next)) {
+            printf("Adjacent free block at %p!\n", header);
+            exit(1);
+        }
+        if (verbose)
+            printf("%p: size %u, alloc %u\n", header, GET_SIZE(header), GET_ALLOC(header));
+        header = next;
+    }
+}